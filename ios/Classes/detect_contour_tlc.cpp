@@ -5,6 +5,8 @@
 #include <numeric>
 #include <cstring>
 #include <sstream>
+#include "image_buffer.hpp"
+#include "output_writer.hpp"
 
 using namespace cv;
 
@@ -312,14 +314,12 @@ static std::vector<Rect> parse_manual_boxes(const char* json_str) {
 }
 
 // ─────────────────────────────────────────────────────────────────────────────
-//  Original function — UNCHANGED for backward compatibility.
+//  Original analysis — UNCHANGED for backward compatibility. Shared by the
+//  file-based export (detect_contour_tlc) and the raw-buffer one below; it
+//  returns the JSON and hands back the annotated image for the caller to
+//  write wherever its input came from.
 // ─────────────────────────────────────────────────────────────────────────────
-const char* detect_contour_tlc(char *image_path, int baseline_y, int topline_y) {
-    Mat img = imread(image_path);
-    if (img.empty()) {
-        return strdup("[]");
-    }
-    
+static std::string detect_contour_tlc_core(const Mat& img, int baseline_y, int topline_y, Mat& result_img) {
     std::pair<Mat, Mat> preprocess_result = load_and_preprocess_image(img);
     Mat resized_img = preprocess_result.first;
     Mat blurred_image = preprocess_result.second;
@@ -375,11 +375,9 @@ const char* detect_contour_tlc(char *image_path, int baseline_y, int topline_y)
     std::pair<Mat, std::vector<Spot>> results = draw_results(resized_img, rectangles, 
                                                             min_required_area, max_aspect_ratio,
                                                             scaled_baseline_y, scaled_topline_y);
-    Mat result_img = results.first;
+    result_img = results.first;
     std::vector<Spot> spots = results.second;
     
-    imwrite(image_path, result_img);
-    
     std::string json = "[";
     for (size_t i = 0; i < spots.size(); ++i) {
         json += "{\"x\":" + std::to_string(spots[i].x) + 
@@ -389,30 +387,95 @@ const char* detect_contour_tlc(char *image_path, int baseline_y, int topline_y)
     }
     json += "]";
     
-    return strdup(json.c_str()); 
+    return json;
+}
+
+
+const char* detect_contour_tlc(char *image_path, int baseline_y, int topline_y) {
+    Mat img = imread(image_path);
+    if (img.empty()) {
+        return strdup("[]");
+    }
+
+    Mat result_img;
+    std::string json = detect_contour_tlc_core(img, baseline_y, topline_y, result_img);
+    imwrite(image_path, result_img);
+    return strdup(json.c_str());
 }
 
 // ─────────────────────────────────────────────────────────────────────────────
-//  NEW: detect_contour_tlc_with_hints
-//
-//  Accepts a JSON array of manually annotated bounding boxes in original image
-//  pixel coordinates: [{"x1":10,"y1":20,"x2":50,"y2":60}, ...]
-//
-//  Scales them through the same crop+resize pipeline, merges with auto-detected
-//  rects, and draws both. Manual boxes bypass NMS and area/aspect filters.
+//  detect_contour_tlc_async: same as detect_contour_tlc, but the annotated
+//  image is encoded and written back to image_path on the writer thread
+//  (output_writer.hpp), with format/quality from output_options. The JSON
+//  comes back immediately; *output_handle receives the handle to pass to
+//  tlc_wait_output() before reading the file (0 if nothing was queued).
 // ─────────────────────────────────────────────────────────────────────────────
 extern "C" __attribute__((visibility("default"))) __attribute__((used))
-const char* detect_contour_tlc_with_hints(
+const char* detect_contour_tlc_async(
         char* image_path,
         int   baseline_y,
         int   topline_y,
-        char* manual_boxes_json) {
+        const char* output_options,
+        int64_t* output_handle) {
 
+    if (output_handle) *output_handle = 0;
     Mat img = imread(image_path);
     if (img.empty()) {
         return strdup("[]");
     }
 
+    Mat result_img;
+    std::string json = detect_contour_tlc_core(img, baseline_y, topline_y, result_img);
+    std::vector<OutputFile> files;
+    files.push_back(OutputFile{ result_img, image_path,
+                                parse_output_options(output_options ? output_options : "") });
+    int64_t handle = queue_outputs(std::move(files));
+    if (output_handle) *output_handle = handle;
+    return strdup(json.c_str());
+}
+
+// ─────────────────────────────────────────────────────────────────────────────
+//  detect_contour_tlc_buffer: same analysis on a raw frame (image_buffer.hpp).
+//  The annotated image goes into `output` when one is given; if it is too
+//  small it is left untouched and output->width/height report the size
+//  needed. The JSON result is returned either way.
+// ─────────────────────────────────────────────────────────────────────────────
+extern "C" __attribute__((visibility("default"))) __attribute__((used))
+const char* detect_contour_tlc_buffer(
+        const ImageBuffer* image,
+        int baseline_y,
+        int topline_y,
+        ImageBuffer* output) {
+
+    Mat img = image_from_buffer(image);
+    if (img.empty()) {
+        return strdup("[]");
+    }
+
+    Mat result_img;
+    std::string json = detect_contour_tlc_core(img, baseline_y, topline_y, result_img);
+    if (output) {
+        image_to_buffer(result_img, output);
+    }
+    return strdup(json.c_str());
+}
+
+// ─────────────────────────────────────────────────────────────────────────────
+//  NEW: detect_contour_tlc_with_hints
+//
+//  Accepts a JSON array of manually annotated bounding boxes in original image
+//  pixel coordinates: [{"x1":10,"y1":20,"x2":50,"y2":60}, ...]
+//
+//  Scales them through the same crop+resize pipeline, merges with auto-detected
+//  rects, and draws both. Manual boxes bypass NMS and area/aspect filters.
+// ─────────────────────────────────────────────────────────────────────────────
+static std::string detect_contour_tlc_with_hints_core(
+        const Mat& img,
+        int   baseline_y,
+        int   topline_y,
+        const char* manual_boxes_json,
+        Mat&  result_img) {
+
     // Preprocess
     std::pair<Mat, Mat> preprocess_result = load_and_preprocess_image(img);
     Mat resized_img   = preprocess_result.first;
@@ -475,7 +538,7 @@ const char* detect_contour_tlc_with_hints(
         draw_results_with_manual(resized_img, auto_rects, scaled_manual,
                                   220, 2.5, scaled_baseline_y, scaled_topline_y);
 
-    imwrite(image_path, results.first);
+    result_img = results.first;
 
     std::string json = "[";
     for (size_t i = 0; i < results.second.size(); ++i) {
@@ -486,5 +549,76 @@ const char* detect_contour_tlc_with_hints(
     }
     json += "]";
 
+    return json;
+}
+
+extern "C" __attribute__((visibility("default"))) __attribute__((used))
+const char* detect_contour_tlc_with_hints(
+        char* image_path,
+        int   baseline_y,
+        int   topline_y,
+        char* manual_boxes_json) {
+
+    Mat img = imread(image_path);
+    if (img.empty()) {
+        return strdup("[]");
+    }
+
+    Mat result_img;
+    std::string json = detect_contour_tlc_with_hints_core(img, baseline_y, topline_y,
+                                                          manual_boxes_json, result_img);
+    imwrite(image_path, result_img);
+    return strdup(json.c_str());
+}
+
+// Async form of detect_contour_tlc_with_hints; output_options and
+// output_handle work as in detect_contour_tlc_async.
+extern "C" __attribute__((visibility("default"))) __attribute__((used))
+const char* detect_contour_tlc_with_hints_async(
+        char* image_path,
+        int   baseline_y,
+        int   topline_y,
+        char* manual_boxes_json,
+        const char* output_options,
+        int64_t* output_handle) {
+
+    if (output_handle) *output_handle = 0;
+    Mat img = imread(image_path);
+    if (img.empty()) {
+        return strdup("[]");
+    }
+
+    Mat result_img;
+    std::string json = detect_contour_tlc_with_hints_core(img, baseline_y, topline_y,
+                                                          manual_boxes_json, result_img);
+    std::vector<OutputFile> files;
+    files.push_back(OutputFile{ result_img, image_path,
+                                parse_output_options(output_options ? output_options : "") });
+    int64_t handle = queue_outputs(std::move(files));
+    if (output_handle) *output_handle = handle;
+    return strdup(json.c_str());
+}
+
+// Raw-frame form of detect_contour_tlc_with_hints; `output` works as in
+// detect_contour_tlc_buffer.
+extern "C" __attribute__((visibility("default"))) __attribute__((used))
+const char* detect_contour_tlc_with_hints_buffer(
+        const ImageBuffer* image,
+        int   baseline_y,
+        int   topline_y,
+        const char* manual_boxes_json,
+        ImageBuffer* output) {
+
+    Mat img = image_from_buffer(image);
+    if (img.empty()) {
+        return strdup("[]");
+    }
+
+    Mat result_img;
+    std::string json = detect_contour_tlc_with_hints_core(img, baseline_y, topline_y,
+                                                          manual_boxes_json, result_img);
+    if (output) {
+        image_to_buffer(result_img, output);
+    }
     return strdup(json.c_str());
-}
\ No newline at end of file
+}
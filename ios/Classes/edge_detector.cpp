@@ -33,59 +33,48 @@ vector<cv::Point> image_to_vector(Mat& image)
 
 vector<cv::Point> EdgeDetector::detect_edges(Mat& image)
 {
-    vector<vector<cv::Point>> squares = find_squares(image);
-    vector<cv::Point>* biggestSquare = NULL;
-
-    // Sort so that the points are ordered clockwise
-
-    struct sortY {
-        bool operator() (cv::Point pt1, cv::Point pt2) { return (pt1.y < pt2.y);}
-    } orderRectangleY;
-    struct sortX {
-        bool operator() (cv::Point pt1, cv::Point pt2) { return (pt1.x < pt2.x);}
-    } orderRectangleX;
-
-    for (int i = 0; i < squares.size(); i++) {
-        vector<cv::Point>* currentSquare = &squares[i];
+    return detect_edges(image, Options());
+}
 
-        std::sort(currentSquare->begin(),currentSquare->end(), orderRectangleY);
-        std::sort(currentSquare->begin(),currentSquare->begin()+2, orderRectangleX);
-        std::sort(currentSquare->begin()+2,currentSquare->end(), orderRectangleX);
+// Quads narrower than 1/5 or wider than 0.99 of the image (either axis)
+// are not the document.
+bool EdgeDetector::within_limits(const Candidate& candidate, const cv::Size& imageSize)
+{
+    if (candidate.width < imageSize.width / 5 || candidate.height < imageSize.height / 5) {
+        return false;
+    }
 
-        float currentSquareWidth = get_width(*currentSquare);
-        float currentSquareHeight = get_height(*currentSquare);
+    if (candidate.width > imageSize.width * 0.99 || candidate.height > imageSize.height * 0.99) {
+        return false;
+    }
 
-        if (currentSquareWidth < image.size().width / 5 || currentSquareHeight < image.size().height / 5) {
-            continue;
-        }
+    return true;
+}
 
-        if (currentSquareWidth > image.size().width * 0.99 || currentSquareHeight > image.size().height * 0.99) {
-            continue;
-        }
+vector<cv::Point> EdgeDetector::detect_edges(Mat& image, const Options& options)
+{
+    vector<Candidate> candidates = find_candidates(image, options);
+    const Candidate* biggest = NULL;
+    float biggestArea = 0;
 
-        if (biggestSquare == NULL) {
-            biggestSquare = currentSquare;
+    // Corners are already ordered and measured by find_candidates.
+    for (const auto& candidate : candidates) {
+        if (!within_limits(candidate, image.size())) {
             continue;
         }
 
-        float biggestSquareWidth = get_width(*biggestSquare);
-        float biggestSquareHeight = get_height(*biggestSquare);
-
-        if (currentSquareWidth * currentSquareHeight >= biggestSquareWidth * biggestSquareHeight) {
-            biggestSquare = currentSquare;
+        float area = candidate.width * candidate.height;
+        if (biggest == NULL || area >= biggestArea) {
+            biggest = &candidate;
+            biggestArea = area;
         }
-
     }
 
-    if (biggestSquare == NULL) {
+    if (biggest == NULL) {
         return image_to_vector(image);
     }
 
-    std::sort(biggestSquare->begin(),biggestSquare->end(), orderRectangleY);
-    std::sort(biggestSquare->begin(),biggestSquare->begin()+2, orderRectangleX);
-    std::sort(biggestSquare->begin()+2,biggestSquare->end(), orderRectangleX);
-
-    return *biggestSquare;
+    return biggest->corners;
 }
 
 float EdgeDetector::get_height(vector<cv::Point>& square) {
@@ -104,11 +93,11 @@ float EdgeDetector::get_width(vector<cv::Point>& square) {
 
 cv::Mat EdgeDetector::debug_squares( cv::Mat image )
 {
-    vector<vector<cv::Point> > squares = find_squares(image);
+    vector<Candidate> candidates = find_candidates(image, Options());
 
-    for (const auto & square : squares) {
+    for (const auto & candidate : candidates) {
         // draw rotated rect
-        cv::RotatedRect minRect = minAreaRect(cv::Mat(square));
+        cv::RotatedRect minRect = minAreaRect(candidate.corners);
         cv::Point2f rect_points[4];
         minRect.points( rect_points );
         for ( int j = 0; j < 4; j++ ) {
@@ -119,31 +108,204 @@ cv::Mat EdgeDetector::debug_squares( cv::Mat image )
     return image;
 }
 
-vector<vector<cv::Point> > EdgeDetector::find_squares(Mat& image)
+// Canny at several thresholds from one gradient pass.
+//
+// Sobel gradients and non-maximum suppression don't depend on the
+// thresholds, so they are computed once: nms keeps the L1 magnitude of
+// every local maximum (OpenCV's rules, including its tie-breaking) and 0
+// elsewhere, padded by one zero pixel on every side. The magnitude is at
+// most 4 * 255 * 2 = 2040, so nms is CV_16U. Each level then only needs
+// hysteresis — pixels above `high` seed edges that grow through
+// 8-connected pixels above `low` — which matches
+// Canny(gray, edges, low, high, 3).
+//
+// Like OpenCV's own Canny, the gradients and magnitude are never held for
+// the whole frame: each stripe of rows keeps them for three rows at a time
+// (previous, current, next), so the only full-size buffer is nms itself.
+static void canny_nms(const Mat& gray, Mat& nms)
 {
-    vector<int> usedThresholdLevel;
-    vector<vector<Point> > squares;
+    const int rows = gray.rows;
+    const int cols = gray.cols;
+    const int TG22 = (int)(0.4142135623730950488016887242097 * (1 << 15) + 0.5);
+
+    nms = Mat::zeros(rows + 2, cols + 2, CV_16U);
+
+    const int stripes = std::max(1, std::min(getNumThreads(), rows / 16));
+    parallel_for_(Range(0, rows), [&](const Range& range) {
+        // Ring of three rows; mag is padded by one zero on each side.
+        vector<short> dxBuf(3 * cols), dyBuf(3 * cols);
+        vector<int> magBuf(3 * (cols + 2), 0);
+
+        // 3x3 Sobel (BORDER_REPLICATE) and L1 magnitude of row i into
+        // ring slot i mod 3; rows outside the image have magnitude 0.
+        auto fillRow = [&](int i) {
+            const int slot = (i + 3) % 3;
+            short* x = &dxBuf[slot * cols];
+            short* y = &dyBuf[slot * cols];
+            int* m = &magBuf[slot * (cols + 2)] + 1;
+            if (i < 0 || i >= rows) {
+                std::fill(m, m + cols, 0);
+                return;
+            }
+            const uchar* above = gray.ptr<uchar>(std::max(i - 1, 0));
+            const uchar* row = gray.ptr<uchar>(i);
+            const uchar* below = gray.ptr<uchar>(std::min(i + 1, rows - 1));
+            for (int j = 0; j < cols; j++) {
+                const int l = std::max(j - 1, 0);
+                const int r = std::min(j + 1, cols - 1);
+                x[j] = (short)((above[r] - above[l]) + 2 * (row[r] - row[l]) + (below[r] - below[l]));
+                y[j] = (short)((below[l] - above[l]) + 2 * (below[j] - above[j]) + (below[r] - above[r]));
+                m[j] = std::abs(x[j]) + std::abs(y[j]);
+            }
+        };
+
+        fillRow(range.start - 1);
+        fillRow(range.start);
+        for (int i = range.start; i < range.end; i++) {
+            fillRow(i + 1);
+
+            const short* x = &dxBuf[(i % 3) * cols];
+            const short* y = &dyBuf[(i % 3) * cols];
+            const int* prev = &magBuf[((i + 2) % 3) * (cols + 2)] + 1;
+            const int* cur = &magBuf[(i % 3) * (cols + 2)] + 1;
+            const int* next = &magBuf[((i + 1) % 3) * (cols + 2)] + 1;
+            ushort* out = nms.ptr<ushort>(i + 1) + 1;
+
+            for (int j = 0; j < cols; j++) {
+                int m = cur[j];
+                if (m == 0) {
+                    continue;
+                }
+                int ax = std::abs(x[j]);
+                int ay = std::abs(y[j]) << 15;
+                int tg22x = ax * TG22;
+                bool peak;
+                if (ay < tg22x) {
+                    peak = m > cur[j - 1] && m >= cur[j + 1];
+                } else if (ay > tg22x + (ax << 16)) {
+                    peak = m > prev[j] && m >= next[j];
+                } else {
+                    int s = (x[j] ^ y[j]) < 0 ? -1 : 1;
+                    peak = m > prev[j - s] && m > next[j + s];
+                }
+                if (peak) {
+                    out[j] = (ushort)m;
+                }
+            }
+        }
+    }, stripes);
+}
 
-    Mat gray0(image.size(), CV_8U), gray;
+static void canny_hysteresis(const Mat& nms, int low, int high, Mat& edges)
+{
+    const int rows = nms.rows - 2;
+    const int cols = nms.cols - 2;
+    const int step = nms.cols;
+
+    // 0 = not an edge, 1 = edge; padded like nms so neighbours need no
+    // bounds checks (the border stays 0 and is never pushed).
+    Mat map = Mat::zeros(nms.size(), CV_8U);
+    uchar* mapData = map.data;
+    const ushort* magData = nms.ptr<ushort>();
+
+    vector<int> stack;
+    for (int i = 1; i <= rows; i++) {
+        for (int j = 1; j <= cols; j++) {
+            int k = i * step + j;
+            if (magData[k] > high && !mapData[k]) {
+                mapData[k] = 1;
+                stack.push_back(k);
+                while (!stack.empty()) {
+                    int p = stack.back();
+                    stack.pop_back();
+                    const int around[8] = { p - step - 1, p - step, p - step + 1, p - 1,
+                                            p + 1, p + step - 1, p + step, p + step + 1 };
+                    for (int n : around) {
+                        if (!mapData[n] && magData[n] > low) {
+                            mapData[n] = 1;
+                            stack.push_back(n);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    edges.create(rows, cols, CV_8U);
+    for (int i = 0; i < rows; i++) {
+        const uchar* src = map.ptr<uchar>(i + 1) + 1;
+        uchar* dst = edges.ptr<uchar>(i);
+        for (int j = 0; j < cols; j++) {
+            dst[j] = src[j] ? 255 : 0;
+        }
+    }
+}
+
+// Quads at or below this share of the image area never stop the search
+// early (Options::earlyExit).
+static const double kDominantAreaFraction = 0.5;
 
-    cvtColor(image , gray, COLOR_BGR2GRAY);
-    medianBlur(gray, gray, 3);      // blur will enhance edge detection
-    vector<vector<cv::Point> > contours;
+vector<EdgeDetector::Candidate> EdgeDetector::find_candidates(Mat& image, const Options& options)
+{
+    Mat gray;
+
+    if (image.channels() == 1) {
+        medianBlur(image, gray, 3); // blur will enhance edge detection
+    } else {
+        cvtColor(image , gray, COLOR_BGR2GRAY);
+        medianBlur(gray, gray, 3);      // blur will enhance edge detection
+    }
+
+    Mat nms;
+    canny_nms(gray, nms);
 
-    int thresholdLevels[] = {10, 30, 50, 70};
-    for(int thresholdLevel : thresholdLevels) {
-        Canny(gray, gray0, thresholdLevel, thresholdLevel*3, 3);
+    const int thresholdLevels[] = {10, 30, 50, 70};
+    const int levelCount = sizeof(thresholdLevels) / sizeof(thresholdLevels[0]);
+
+    // A quad's corners lie on its contour, so a contour whose bounding box
+    // is already below the size limits (or whose box can't hold the 1000 px
+    // area minimum) can't produce a usable quad. That also bounds its
+    // perimeter, so the rejection happens before arcLength/approxPolyDP.
+    const int minWidth = image.cols / 5;
+    const int minHeight = image.rows / 5;
+
+    struct sortY {
+        bool operator() (cv::Point pt1, cv::Point pt2) { return (pt1.y < pt2.y);}
+    } orderRectangleY;
+    struct sortX {
+        bool operator() (cv::Point pt1, cv::Point pt2) { return (pt1.x < pt2.x);}
+    } orderRectangleX;
+
+    // One result list per level, concatenated in level order afterwards so
+    // the output is the same whether or not the levels ran in parallel.
+    vector<vector<Candidate> > candidatesPerLevel(levelCount);
+
+    // Returns true if the level found a quad dominant enough to stop at.
+    auto runLevel = [&](int level) {
+        int thresholdLevel = thresholdLevels[level];
+        vector<Candidate>& candidates = candidatesPerLevel[level];
+        bool dominant = false;
+
+        Mat gray0;
+        canny_hysteresis(nms, thresholdLevel, thresholdLevel*3, gray0);
 
         dilate(gray0, gray0, Mat(), Point(-1, -1));
 
+        vector<vector<cv::Point> > contours;
         findContours(gray0, contours, CV_RETR_LIST, CV_CHAIN_APPROX_SIMPLE);
 
         vector<Point> approx;
         for (const auto & contour : contours) {
-            approxPolyDP(Mat(contour), approx, arcLength(Mat(contour), true) * 0.02, true);
+            Rect box = boundingRect(contour);
+            if (box.width - 1 < minWidth || box.height - 1 < minHeight ||
+                (double)(box.width - 1) * (box.height - 1) <= 1000) {
+                continue;
+            }
 
-            if (approx.size() == 4 && fabs(contourArea(Mat(approx))) > 1000 &&
-                isContourConvex(Mat(approx))) {
+            approxPolyDP(contour, approx, arcLength(contour, true) * 0.02, true);
+
+            if (approx.size() == 4 && fabs(contourArea(approx)) > 1000 &&
+                isContourConvex(approx)) {
                 double maxCosine = 0;
 
                 for (int j = 2; j < 5; j++) {
@@ -152,12 +314,44 @@ vector<vector<cv::Point> > EdgeDetector::find_squares(Mat& image)
                 }
 
                 if (maxCosine < 0.3) {
-                    squares.push_back(approx);
-                    usedThresholdLevel.push_back(thresholdLevel);
+                    // Order the corners (top pair, then bottom pair, each
+                    // left to right) and measure once.
+                    Candidate candidate;
+                    candidate.corners = approx;
+                    std::sort(candidate.corners.begin(), candidate.corners.end(), orderRectangleY);
+                    std::sort(candidate.corners.begin(), candidate.corners.begin()+2, orderRectangleX);
+                    std::sort(candidate.corners.begin()+2, candidate.corners.end(), orderRectangleX);
+                    candidate.width = get_width(candidate.corners);
+                    candidate.height = get_height(candidate.corners);
+
+                    if (within_limits(candidate, image.size()) &&
+                        candidate.width * candidate.height > kDominantAreaFraction * image.cols * image.rows) {
+                        dominant = true;
+                    }
+                    candidates.push_back(candidate);
                 }
             }
         }
+        return dominant;
+    };
+
+    if (options.parallelLevels) {
+        parallel_for_(Range(0, levelCount), [&](const Range& range) {
+            for (int level = range.start; level < range.end; level++) {
+                runLevel(level);
+            }
+        });
+    } else {
+        for (int level = 0; level < levelCount; level++) {
+            if (runLevel(level) && options.earlyExit) {
+                break;
+            }
+        }
     }
 
-    return squares;
+    vector<Candidate> candidates;
+    for (auto& levelCandidates : candidatesPerLevel) {
+        candidates.insert(candidates.end(), levelCandidates.begin(), levelCandidates.end());
+    }
+    return candidates;
 }
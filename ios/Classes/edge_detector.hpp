@@ -6,12 +6,35 @@ using namespace std;
 
 class EdgeDetector {
     public:
+    struct Options {
+        // Run the per-threshold contour passes of find_candidates on
+        // OpenCV's thread pool instead of one after another.
+        bool parallelLevels = false;
+
+        // Stop after the first threshold level (lowest first) that
+        // yields an acceptable quad covering over half the image, instead
+        // of always running all four. Ignored with parallelLevels.
+        bool earlyExit = false;
+    };
+
+    // image is BGR, or single-channel 8-bit when the caller already has
+    // the gray plane (it is used as-is, with no colour round-trip).
     static vector<cv::Point> detect_edges( Mat& image);
+    static vector<cv::Point> detect_edges( Mat& image, const Options& options);
     static Mat debug_squares( Mat image );
     
     private:
+    // A convex four-corner contour, corners ordered top-left, top-right,
+    // bottom-left, bottom-right, with get_width/get_height precomputed.
+    struct Candidate {
+        vector<cv::Point> corners;
+        float width;
+        float height;
+    };
+
     static double get_cosine_angle_between_vectors( cv::Point pt1, cv::Point pt2, cv::Point pt0 );
-    static vector<vector<cv::Point> > find_squares(Mat& image);
+    static vector<Candidate> find_candidates(Mat& image, const Options& options);
+    static bool within_limits(const Candidate& candidate, const cv::Size& imageSize);
     static float get_width(vector<cv::Point>& square);
     static float get_height(vector<cv::Point>& square);
 };
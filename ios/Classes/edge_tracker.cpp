@@ -0,0 +1,283 @@
+#include "edge_tracker.hpp"
+#include "edge_detector.hpp"
+#include "image_buffer.hpp"
+
+#include <cmath>
+#include <mutex>
+#include <opencv2/opencv.hpp>
+
+namespace {
+    const int kDefaultWorkingSize = 480;
+
+    // Tracking gives up (and a full detection runs) below this many
+    // surviving feature points or this share of RANSAC inliers.
+    const size_t kMinFeatures = 8;
+    const double kMinConfidence = 0.5;
+
+    // Frames between forced re-detections while tracking succeeds.
+    const int kRedetectInterval = 45;
+
+    // Failed detections a tracked quad is held through (with decaying
+    // confidence) before it is dropped.
+    const int kMaxMissedDetections = 5;
+
+    // Weight of the new position in the corner smoothing, and the jump
+    // (share of the frame diagonal) past which smoothing snaps instead.
+    const float kSmoothing = 0.5f;
+    const float kSnapFraction = 0.05f;
+
+    const int kMaxFeatures = 60;
+
+    bool is_full_frame(const std::vector<cv::Point>& pts, const cv::Size& size)
+    {
+        return pts[0] == cv::Point(0, 0) && pts[1] == cv::Point(size.width, 0) &&
+               pts[2] == cv::Point(0, size.height) && pts[3] == cv::Point(size.width, size.height);
+    }
+
+    // Corners are kept in detect_edges order (TL, TR, BL, BR); polygons
+    // need them around the ring instead.
+    std::vector<cv::Point2f> ring(const std::vector<cv::Point2f>& c)
+    {
+        return { c[0], c[1], c[3], c[2] };
+    }
+
+    // A tracked quad must stay convex and not collapse below the size
+    // full detection would accept.
+    bool plausible(const std::vector<cv::Point2f>& corners, const cv::Size& size)
+    {
+        std::vector<cv::Point2f> poly = ring(corners);
+        if (!cv::isContourConvex(poly)) {
+            return false;
+        }
+        cv::Rect2f box = cv::boundingRect(poly);
+        return box.width >= size.width / 5.0f && box.height >= size.height / 5.0f;
+    }
+}
+
+struct EdgeTracker
+{
+    std::mutex mutex;
+    int workingSize;
+    EdgeDetector::Options options;
+
+    cv::Mat previous;                     // last frame, working size
+    cv::Mat current;                      // frame being pushed (swapped with
+                                          // previous afterwards)
+    cv::Mat scratch;                      // buffer_to_mat's conversion buffer
+    // current and scratch keep their allocations from frame to frame and
+    // are only touched by the pushing thread.
+    std::vector<cv::Point2f> features;    // tracked points in `previous`
+    size_t detectedFeatures = 0;          // feature count at the last detection
+    std::vector<cv::Point2f> corners;     // raw quad; empty = none
+    std::vector<cv::Point2f> smoothed;
+    double confidence = 0;
+    int64_t frame = 0;
+    int framesSinceDetection = 0;
+    int missedDetections = 0;
+
+    EdgeTrackerQuad latest;
+    bool hasLatest = false;
+
+    bool track(const cv::Mat& gray);
+    void detect(const cv::Mat& gray);
+    void publish(const cv::Size& size);
+};
+
+bool EdgeTracker::track(const cv::Mat& gray)
+{
+    std::vector<cv::Point2f> next, back;
+    std::vector<uchar> status, backStatus;
+    std::vector<float> error;
+    const cv::Size window(21, 21);
+    cv::calcOpticalFlowPyrLK(previous, gray, features, next, status, error, window, 3);
+    cv::calcOpticalFlowPyrLK(gray, previous, next, back, backStatus, error, window, 3);
+
+    std::vector<cv::Point2f> from, to;
+    for (size_t i = 0; i < features.size(); i++) {
+        cv::Point2f d = back[i] - features[i];
+        if (status[i] && backStatus[i] && d.dot(d) < 1.0f) {
+            from.push_back(features[i]);
+            to.push_back(next[i]);
+        }
+    }
+    if (from.size() < kMinFeatures) {
+        return false;
+    }
+
+    std::vector<uchar> inliers;
+    cv::Mat homography = cv::findHomography(from, to, cv::RANSAC, 3.0, inliers);
+    if (homography.empty()) {
+        return false;
+    }
+
+    std::vector<cv::Point2f> kept;
+    for (size_t i = 0; i < to.size(); i++) {
+        if (inliers[i]) kept.push_back(to[i]);
+    }
+    double trackConfidence = (double)kept.size() / detectedFeatures;
+    if (kept.size() < kMinFeatures || trackConfidence < kMinConfidence) {
+        return false;
+    }
+
+    std::vector<cv::Point2f> moved;
+    cv::perspectiveTransform(corners, moved, homography);
+    if (!plausible(moved, gray.size())) {
+        return false;
+    }
+
+    corners = moved;
+    features = kept;
+    confidence = trackConfidence;
+    framesSinceDetection++;
+    return true;
+}
+
+void EdgeTracker::detect(const cv::Mat& gray)
+{
+    // Gray in, no colour round-trip (detect_edges wants a non-const Mat).
+    cv::Mat frameGray = gray;
+    std::vector<cv::Point> found = EdgeDetector::detect_edges(frameGray, options);
+
+    features.clear();
+    framesSinceDetection = 0;
+
+    if (is_full_frame(found, gray.size())) {
+        if (++missedDetections > kMaxMissedDetections) {
+            corners.clear();
+            smoothed.clear();
+            confidence = 0;
+        } else {
+            confidence *= 0.5;
+        }
+        return;
+    }
+
+    missedDetections = 0;
+    confidence = 1;
+    corners.assign(found.begin(), found.end());
+
+    // Texture inside the document (plus its corners) to follow until the
+    // next detection.
+    cv::Mat mask = cv::Mat::zeros(gray.size(), CV_8U);
+    std::vector<cv::Point> poly;
+    for (const auto& p : ring(corners)) poly.push_back(cv::Point(cvRound(p.x), cvRound(p.y)));
+    cv::fillConvexPoly(mask, poly, cv::Scalar(255));
+    cv::goodFeaturesToTrack(gray, features, kMaxFeatures, 0.01, 7, mask);
+    features.insert(features.end(), corners.begin(), corners.end());
+    detectedFeatures = features.size();
+}
+
+void EdgeTracker::publish(const cv::Size& size)
+{
+    if (corners.empty()) {
+        smoothed.clear();
+        return;
+    }
+
+    const float snap = kSnapFraction * std::sqrt((float)(size.width * size.width + size.height * size.height));
+    bool jump = smoothed.size() != corners.size();
+    for (size_t i = 0; !jump && i < corners.size(); i++) {
+        cv::Point2f d = corners[i] - smoothed[i];
+        jump = std::sqrt(d.dot(d)) > snap;
+    }
+    if (jump) {
+        smoothed = corners;
+    } else {
+        for (size_t i = 0; i < corners.size(); i++) {
+            smoothed[i] += kSmoothing * (corners[i] - smoothed[i]);
+        }
+    }
+
+    Coordinate* out[4] = { &latest.topLeft, &latest.topRight, &latest.bottomLeft, &latest.bottomRight };
+    for (int i = 0; i < 4; i++) {
+        out[i]->x = std::min(std::max(smoothed[i].x / size.width, 0.0f), 1.0f);
+        out[i]->y = std::min(std::max(smoothed[i].y / size.height, 0.0f), 1.0f);
+    }
+    latest.confidence = confidence;
+    latest.frame = frame;
+    hasLatest = true;
+}
+
+extern "C" __attribute__((visibility("default"))) __attribute__((used))
+struct EdgeTracker *edge_tracker_create(int working_size, int flags)
+{
+    EdgeTracker *tracker = new (std::nothrow) EdgeTracker();
+    if (!tracker) {
+        return NULL;
+    }
+    tracker->workingSize = working_size > 0 ? working_size : kDefaultWorkingSize;
+    tracker->options.parallelLevels = (flags & EDGE_DETECTION_PARALLEL_LEVELS) != 0;
+    tracker->options.earlyExit = (flags & EDGE_DETECTION_EARLY_EXIT) != 0;
+    return tracker;
+}
+
+extern "C" __attribute__((visibility("default"))) __attribute__((used))
+int edge_tracker_push_frame(struct EdgeTracker *tracker, const struct ImageBuffer *frame)
+{
+    if (!tracker) {
+        return -1;
+    }
+    if (!buffer_to_mat(frame, true, tracker->workingSize, tracker->current, tracker->scratch)) {
+        return -1;
+    }
+    const cv::Mat& gray = tracker->current;
+
+    std::lock_guard<std::mutex> lock(tracker->mutex);
+    tracker->frame++;
+
+    bool sameSize = tracker->previous.size() == gray.size();
+    if (!sameSize) {
+        tracker->corners.clear();
+        tracker->smoothed.clear();
+        tracker->features.clear();
+    }
+
+    bool tracked = !tracker->corners.empty() && !tracker->features.empty() &&
+                   tracker->framesSinceDetection < kRedetectInterval &&
+                   tracker->track(gray);
+    if (!tracked) {
+        tracker->detect(gray);
+    }
+
+    cv::swap(tracker->previous, tracker->current);
+    tracker->publish(tracker->previous.size());
+    return tracker->corners.empty() ? 0 : 1;
+}
+
+extern "C" __attribute__((visibility("default"))) __attribute__((used))
+int edge_tracker_poll(struct EdgeTracker *tracker, struct EdgeTrackerQuad *out)
+{
+    if (!tracker || !out) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(tracker->mutex);
+    if (!tracker->hasLatest) {
+        return 0;
+    }
+    *out = tracker->latest;
+    if (tracker->corners.empty()) {
+        out->confidence = 0;
+    }
+    return 1;
+}
+
+extern "C" __attribute__((visibility("default"))) __attribute__((used))
+void edge_tracker_reset(struct EdgeTracker *tracker)
+{
+    if (!tracker) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(tracker->mutex);
+    tracker->corners.clear();
+    tracker->smoothed.clear();
+    tracker->features.clear();
+    tracker->confidence = 0;
+    tracker->missedDetections = 0;
+    tracker->hasLatest = false;
+}
+
+extern "C" __attribute__((visibility("default"))) __attribute__((used))
+void edge_tracker_destroy(struct EdgeTracker *tracker)
+{
+    delete tracker;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdint.h>
+#include "native_edge_detection.hpp"
+
+// Streaming document-edge detection for a live camera preview.
+//
+// detect_edges runs the full multi-threshold search on every call, far
+// too slow to repeat at preview rate. A tracker runs that search once
+// and then follows the quad from frame to frame: feature points inside
+// the document are tracked with pyramidal Lucas-Kanade optical flow
+// (forward-backward checked), a RANSAC homography over them moves the
+// four corners, and the corners are smoothed before being reported.
+// Full detection only runs again when tracking confidence drops, the
+// quad stops being plausible, or every ~1.5 s to correct drift.
+//
+// Usage: create one tracker per preview session, push every frame (or as
+// many as keep up) from one thread, poll from any thread, destroy when
+// done. Frames may differ in size between pushes; the tracker restarts
+// from a full detection when they do.
+
+struct EdgeTracker;
+
+struct EdgeTrackerQuad
+{
+    struct Coordinate topLeft;     // normalized 0..1, like detect_edges
+    struct Coordinate topRight;
+    struct Coordinate bottomLeft;
+    struct Coordinate bottomRight;
+    double confidence;             // 0 = no document in view, 1 = just detected
+    int64_t frame;                 // push count of the frame it belongs to (from 1)
+};
+
+// working_size: longer side, in pixels, that frames are analysed at
+// (0 = 480). flags: EdgeDetectionFlags for the full detections
+// (EDGE_DETECTION_REFINE_CORNERS is ignored here). NULL on failure.
+extern "C"
+struct EdgeTracker *edge_tracker_create(int working_size, int flags);
+
+// Analyses one frame. Returns 1 if a quad is being tracked after it, 0 if
+// not, -1 if the buffer is invalid.
+extern "C"
+int edge_tracker_push_frame(struct EdgeTracker *tracker, const struct ImageBuffer *frame);
+
+// Copies the latest smoothed quad into *out. Returns 0 (and leaves *out
+// alone) until the first quad has been found.
+extern "C"
+int edge_tracker_poll(struct EdgeTracker *tracker, struct EdgeTrackerQuad *out);
+
+// Forgets the current quad; the next frame runs a full detection.
+extern "C"
+void edge_tracker_reset(struct EdgeTracker *tracker);
+
+extern "C"
+void edge_tracker_destroy(struct EdgeTracker *tracker);
@@ -0,0 +1,168 @@
+#include "frame_worker.hpp"
+#include "edge_detector.hpp"
+
+#include <opencv2/opencv.hpp>
+
+FrameWorker::FrameWorker(int kind, Job job, int working_size, std::shared_ptr<void> ctx)
+    : kind(kind),
+      context(std::move(ctx)),
+      job_(std::move(job)),
+      workingSize_(working_size),
+      mailbox_(1),
+      pushed_(0),
+      processed_(0),
+      dropped_(0),
+      stop_(false)
+{
+    thread_ = std::thread(&FrameWorker::run, this);
+}
+
+FrameWorker::~FrameWorker()
+{
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex_);
+        stop_ = true;
+    }
+    wake_.notify_one();
+    thread_.join();
+}
+
+bool FrameWorker::push(const ImageBuffer* frame)
+{
+    std::lock_guard<std::mutex> lock(pushMutex_);
+
+    Slot& slot = slots_[producer_];
+    if (!buffer_to_mat(frame, false, workingSize_, slot.image, scratch_)) {
+        return false;
+    }
+    slot.index = ++pushed_;
+
+    int previous = mailbox_.exchange(producer_ | kFresh, std::memory_order_acq_rel);
+    if (previous & kFresh) {
+        dropped_++;
+    }
+    producer_ = previous & ~kFresh;
+
+    {
+        std::lock_guard<std::mutex> wakeLock(wakeMutex_);
+    }
+    wake_.notify_one();
+    return true;
+}
+
+FrameWorkerStats FrameWorker::stats() const
+{
+    FrameWorkerStats s;
+    s.pushed = pushed_.load();
+    s.processed = processed_.load();
+    s.dropped = dropped_.load();
+    return s;
+}
+
+void FrameWorker::run()
+{
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(wakeMutex_);
+            wake_.wait(lock, [&] { return stop_.load() || (mailbox_.load() & kFresh) != 0; });
+            if (stop_) {
+                return;
+            }
+        }
+
+        // Hand our old slot back and take the newest frame.
+        consumer_ = mailbox_.exchange(consumer_, std::memory_order_acq_rel) & ~kFresh;
+        const Slot& slot = slots_[consumer_];
+        try {
+            job_(slot.image, slot.index);
+        } catch (const std::exception&) {
+            // A bad frame must not take the worker down; the next one
+            // gets its turn.
+        }
+        processed_++;
+    }
+}
+
+namespace {
+    const int kDefaultWorkingSize = 480;
+
+    struct EdgeResults
+    {
+        std::mutex mutex;
+        EdgeTrackerQuad latest;
+        bool has = false;
+    };
+}
+
+extern "C" __attribute__((visibility("default"))) __attribute__((used))
+struct FrameWorker *frame_worker_create_edges(int working_size, int flags)
+{
+    EdgeDetector::Options options;
+    options.parallelLevels = (flags & EDGE_DETECTION_PARALLEL_LEVELS) != 0;
+    options.earlyExit = (flags & EDGE_DETECTION_EARLY_EXIT) != 0;
+
+    try {
+        auto results = std::make_shared<EdgeResults>();
+        EdgeResults* raw = results.get();
+        auto job = [raw, options](const cv::Mat& frame, int64_t index) {
+            Mat image = frame;
+            vector<cv::Point> points = EdgeDetector::detect_edges(image, options);
+            bool found = !(points[0] == cv::Point(0, 0) && points[3] == cv::Point(frame.cols, frame.rows));
+
+            EdgeTrackerQuad quad;
+            Coordinate* out[4] = { &quad.topLeft, &quad.topRight, &quad.bottomLeft, &quad.bottomRight };
+            for (int i = 0; i < 4; i++) {
+                out[i]->x = (double)points[i].x / frame.cols;
+                out[i]->y = (double)points[i].y / frame.rows;
+            }
+            quad.confidence = found ? 1 : 0;
+            quad.frame = index;
+
+            std::lock_guard<std::mutex> lock(raw->mutex);
+            raw->latest = quad;
+            raw->has = true;
+        };
+        return new FrameWorker(FRAME_WORKER_EDGES, job, working_size > 0 ? working_size : kDefaultWorkingSize, results);
+    } catch (const std::exception&) {
+        return NULL;
+    }
+}
+
+extern "C" __attribute__((visibility("default"))) __attribute__((used))
+int frame_worker_push(struct FrameWorker *worker, const struct ImageBuffer *frame)
+{
+    if (!worker) {
+        return -1;
+    }
+    return worker->push(frame) ? 1 : -1;
+}
+
+extern "C" __attribute__((visibility("default"))) __attribute__((used))
+int frame_worker_poll_edges(struct FrameWorker *worker, struct EdgeTrackerQuad *out)
+{
+    if (!worker || !out || worker->kind != FRAME_WORKER_EDGES) {
+        return 0;
+    }
+    EdgeResults* results = static_cast<EdgeResults*>(worker->context.get());
+    std::lock_guard<std::mutex> lock(results->mutex);
+    if (!results->has) {
+        return 0;
+    }
+    *out = results->latest;
+    return 1;
+}
+
+extern "C" __attribute__((visibility("default"))) __attribute__((used))
+void frame_worker_stats(struct FrameWorker *worker, struct FrameWorkerStats *out)
+{
+    if (!worker || !out) {
+        return;
+    }
+    *out = worker->stats();
+}
+
+extern "C" __attribute__((visibility("default"))) __attribute__((used))
+void frame_worker_destroy(struct FrameWorker *worker)
+{
+    delete worker;
+}
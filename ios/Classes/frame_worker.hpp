@@ -0,0 +1,128 @@
+#pragma once
+
+#include <stdint.h>
+#include "image_buffer.hpp"
+#include "edge_tracker.hpp"
+
+// Continuous native processing of camera frames.
+//
+// Each analysis call used to take a file path, so a live preview meant
+// one Dart isolate, one JPEG round-trip and one full decode per frame. A
+// FrameWorker instead owns a persistent worker thread. The camera side
+// pushes raw frames and the worker always processes the newest one.
+//
+//   - Frames are converted (to BGR at the worker's working resolution)
+//     into a fixed pool of three recycled buffers: one being filled, one
+//     in the mailbox, and one being processed. Same-sized frames never
+//     allocate.
+//   - The mailbox is a single atomic slot index. Pushing swaps the new
+//     frame in, so a frame the worker hadn't taken yet is replaced, not
+//     queued. The worker only processes the latest frame and the camera
+//     side never waits for it. Replaced frames are counted as dropped.
+//
+// The worker kind sets what runs on each frame and how results are
+// polled: frame_worker_create_edges here (EdgeDetector::detect_edges),
+// tlc_lane_worker_create in new_backend/ffi_exports.cpp (strip-model
+// lane detection). Push, stats and destroy are shared.
+
+struct FrameWorker;
+
+enum FrameWorkerKind
+{
+    FRAME_WORKER_EDGES = 0,
+    FRAME_WORKER_LANES = 1
+};
+
+struct FrameWorkerStats
+{
+    int64_t pushed;     // frames accepted by frame_worker_push
+    int64_t processed;  // frames the worker finished
+    int64_t dropped;    // frames replaced in the mailbox before being taken
+};
+
+// Edge detection on every frame taken. working_size: longer side frames
+// are analysed at (0 = 480); flags: EdgeDetectionFlags
+// (EDGE_DETECTION_REFINE_CORNERS is ignored). Poll results with
+// frame_worker_poll_edges. NULL on failure.
+extern "C"
+struct FrameWorker *frame_worker_create_edges(int working_size, int flags);
+
+// Copies `frame` into the pool and posts it; returns without waiting for
+// processing. Returns 1, or -1 if the buffer is invalid. Safe from any
+// thread (concurrent pushes are serialized).
+extern "C"
+int frame_worker_push(struct FrameWorker *worker, const struct ImageBuffer *frame);
+
+// Latest edge result (confidence 1 = quad found, 0 = none; frame = the
+// push count it came from). Returns 0 until the first frame is processed,
+// or if the worker isn't an edge worker.
+extern "C"
+int frame_worker_poll_edges(struct FrameWorker *worker, struct EdgeTrackerQuad *out);
+
+extern "C"
+void frame_worker_stats(struct FrameWorker *worker, struct FrameWorkerStats *out);
+
+// Stops the worker (finishing the frame in progress) and frees it.
+extern "C"
+void frame_worker_destroy(struct FrameWorker *worker);
+
+#ifdef __cplusplus
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <opencv2/core.hpp>
+
+struct FrameWorker
+{
+    // Runs on the worker thread for each frame taken; `frame` is BGR at
+    // the working size and only valid during the call.
+    typedef std::function<void(const cv::Mat& frame, int64_t index)> Job;
+
+    // working_size: longer side frames are downscaled to (0 = full size).
+    // context is kept alive with the worker, for the poll functions of
+    // its kind (a FrameWorkerKind) to find their results through.
+    FrameWorker(int kind, Job job, int working_size, std::shared_ptr<void> context);
+    ~FrameWorker();
+
+    bool push(const ImageBuffer* frame);
+    FrameWorkerStats stats() const;
+
+    const int kind;
+    std::shared_ptr<void> context;
+
+private:
+    struct Slot
+    {
+        cv::Mat image;
+        int64_t index = 0;
+    };
+
+    static const int kFresh = 4; // mailbox flag: holds a frame not yet taken
+
+    void run();
+
+    Job job_;
+    int workingSize_;
+
+    Slot slots_[3];
+    std::atomic<int> mailbox_;
+    int producer_ = 0;             // slot being filled (push side only)
+    int consumer_ = 2;             // slot being processed (worker only)
+    cv::Mat scratch_;              // push-side colour conversion
+    std::mutex pushMutex_;
+
+    std::atomic<int64_t> pushed_;
+    std::atomic<int64_t> processed_;
+    std::atomic<int64_t> dropped_;
+
+    // Only for sleeping while the mailbox is empty; frames never pass
+    // through it.
+    std::mutex wakeMutex_;
+    std::condition_variable wake_;
+    std::atomic<bool> stop_;
+    std::thread thread_;
+};
+#endif
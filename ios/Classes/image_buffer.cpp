@@ -0,0 +1,134 @@
+#include "image_buffer.hpp"
+#include <opencv2/imgproc.hpp>
+
+cv::Mat image_from_buffer(const ImageBuffer* buf)
+{
+    cv::Mat bgr;
+    if (!buf || !buf->data || buf->width <= 0 || buf->height <= 0) {
+        return bgr;
+    }
+
+    const int w = buf->width;
+    const int h = buf->height;
+
+    switch (buf->format) {
+    case IMAGE_BUFFER_BGRA:
+    case IMAGE_BUFFER_RGBA: {
+        if (buf->stride < w * 4) return bgr;
+        cv::Mat src(h, w, CV_8UC4, buf->data, buf->stride);
+        cv::cvtColor(src, bgr, buf->format == IMAGE_BUFFER_BGRA ? cv::COLOR_BGRA2BGR : cv::COLOR_RGBA2BGR);
+        break;
+    }
+    case IMAGE_BUFFER_BGR: {
+        if (buf->stride < w * 3) return bgr;
+        cv::Mat(h, w, CV_8UC3, buf->data, buf->stride).copyTo(bgr);
+        break;
+    }
+    case IMAGE_BUFFER_NV21:
+    case IMAGE_BUFFER_I420: {
+        if ((w | h) & 1 || buf->stride < w) return bgr;
+        // One single-channel view over all three planes; OpenCV finds the
+        // chroma planes from the row step (stride for NV21's VU plane,
+        // stride/2 for I420's U and V planes).
+        cv::Mat src(h + h / 2, w, CV_8UC1, buf->data, buf->stride);
+        cv::cvtColor(src, bgr, buf->format == IMAGE_BUFFER_NV21 ? cv::COLOR_YUV2BGR_NV21 : cv::COLOR_YUV2BGR_I420);
+        break;
+    }
+    default:
+        break;
+    }
+    return bgr;
+}
+
+bool buffer_to_mat(const ImageBuffer* buf, bool gray, int max_side, cv::Mat& out, cv::Mat& scratch)
+{
+    if (!buf || !buf->data || buf->width <= 0 || buf->height <= 0) {
+        return false;
+    }
+
+    const int w = buf->width;
+    const int h = buf->height;
+
+    cv::Mat src;
+    int code = -1;
+    switch (buf->format) {
+    case IMAGE_BUFFER_BGRA:
+    case IMAGE_BUFFER_RGBA:
+        if (buf->stride < w * 4) return false;
+        src = cv::Mat(h, w, CV_8UC4, buf->data, buf->stride);
+        if (buf->format == IMAGE_BUFFER_BGRA) {
+            code = gray ? cv::COLOR_BGRA2GRAY : cv::COLOR_BGRA2BGR;
+        } else {
+            code = gray ? cv::COLOR_RGBA2GRAY : cv::COLOR_RGBA2BGR;
+        }
+        break;
+    case IMAGE_BUFFER_BGR:
+        if (buf->stride < w * 3) return false;
+        src = cv::Mat(h, w, CV_8UC3, buf->data, buf->stride);
+        code = gray ? cv::COLOR_BGR2GRAY : -1;
+        break;
+    case IMAGE_BUFFER_NV21:
+    case IMAGE_BUFFER_I420:
+        if ((w | h) & 1 || buf->stride < w) return false;
+        if (gray) {
+            // The Y plane already is the gray image; read it in place.
+            src = cv::Mat(h, w, CV_8UC1, buf->data, buf->stride);
+        } else {
+            src = cv::Mat(h + h / 2, w, CV_8UC1, buf->data, buf->stride);
+            code = buf->format == IMAGE_BUFFER_NV21 ? cv::COLOR_YUV2BGR_NV21 : cv::COLOR_YUV2BGR_I420;
+        }
+        break;
+    default:
+        return false;
+    }
+
+    const int longest = w > h ? w : h;
+    if (max_side > 0 && longest > max_side) {
+        double scale = (double)max_side / longest;
+        if (code >= 0) {
+            cv::cvtColor(src, scratch, code);
+            cv::resize(scratch, out, cv::Size(), scale, scale, cv::INTER_AREA);
+        } else {
+            cv::resize(src, out, cv::Size(), scale, scale, cv::INTER_AREA);
+        }
+    } else if (code >= 0) {
+        cv::cvtColor(src, out, code);
+    } else {
+        src.copyTo(out);
+    }
+    return true;
+}
+
+bool image_to_buffer(const cv::Mat& bgr, ImageBuffer* out)
+{
+    if (!out || bgr.empty() || bgr.type() != CV_8UC3) {
+        return false;
+    }
+
+    int channels;
+    int code;
+    switch (out->format) {
+    case IMAGE_BUFFER_BGRA: channels = 4; code = cv::COLOR_BGR2BGRA; break;
+    case IMAGE_BUFFER_RGBA: channels = 4; code = cv::COLOR_BGR2RGBA; break;
+    case IMAGE_BUFFER_BGR:  channels = 3; code = -1; break;
+    default: return false;
+    }
+
+    const int row_bytes = bgr.cols * channels;
+    const int stride = out->stride >= row_bytes ? out->stride : row_bytes;
+
+    out->width = bgr.cols;
+    out->height = bgr.rows;
+    out->stride = stride;
+    if (!out->data || out->capacity < (size_t)stride * bgr.rows) {
+        return false;
+    }
+
+    cv::Mat dst(bgr.rows, bgr.cols, CV_8UC(channels), out->data, stride);
+    if (code < 0) {
+        bgr.copyTo(dst);
+    } else {
+        cv::cvtColor(bgr, dst, code);
+    }
+    return true;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stddef.h>
+
+// In-memory image exchange for the *_buffer entry points.
+//
+// Camera frames used to reach us as JPEG files: the app encoded each frame
+// to disk, every entry point decoded it again with imread, and annotated
+// results went back out through imwrite. An ImageBuffer hands the raw
+// pixels over directly instead, and results can be written straight into
+// a caller-owned buffer.
+//
+// Input formats:
+//   IMAGE_BUFFER_BGRA / RGBA / BGR — packed, `stride` bytes per row.
+//   IMAGE_BUFFER_NV21 — Y plane (height rows of `stride` bytes) followed
+//     directly by the interleaved VU plane (height/2 rows, same stride).
+//   IMAGE_BUFFER_I420 — Y plane, then U and V planes of height/2 rows with
+//     stride/2 bytes each, all contiguous (the packed YUV420 layout).
+//   YUV formats need an even width and height.
+//
+// Output buffers only take BGRA, RGBA or BGR. The caller sets data,
+// capacity (bytes), format and optionally stride (0 = tightly packed);
+// width, height and stride are filled in with the written image's size.
+// If capacity is too small nothing is written, the call reports failure,
+// and width/height/stride still say how much room is needed.
+
+enum ImageBufferFormat
+{
+    IMAGE_BUFFER_BGRA = 0,
+    IMAGE_BUFFER_RGBA = 1,
+    IMAGE_BUFFER_NV21 = 2,
+    IMAGE_BUFFER_I420 = 3,
+    IMAGE_BUFFER_BGR = 4
+};
+
+struct ImageBuffer
+{
+    unsigned char* data;
+    int width;
+    int height;
+    int stride;
+    int format;
+    size_t capacity; // output only
+};
+
+#ifdef __cplusplus
+#include <opencv2/core.hpp>
+
+// Converts a caller buffer into a freshly allocated BGR image (never
+// aliases buf->data). Returns an empty Mat if the buffer is invalid.
+cv::Mat image_from_buffer(const ImageBuffer* buf);
+
+// Converts a caller buffer into `out` — BGR, or single-channel when
+// `gray` — area-downscaled so its longer side is at most max_side (0 =
+// full size). `scratch` holds the full-size colour conversion when there
+// is one. Both keep their allocations across calls with the same frame
+// size, so converting frame after frame into the same Mats doesn't
+// allocate. Returns false if the buffer is invalid.
+bool buffer_to_mat(const ImageBuffer* buf, bool gray, int max_side, cv::Mat& out, cv::Mat& scratch);
+
+// Writes a BGR image into a caller buffer, converting to its format.
+// Returns false (and writes nothing) if the format is not an output
+// format or the buffer is too small — see the comment above.
+bool image_to_buffer(const cv::Mat& bgr, ImageBuffer* out);
+#endif
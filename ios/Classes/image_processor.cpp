@@ -11,12 +11,18 @@ Point2f computePoint(int p1, int p2) {
 }
 
 Mat ImageProcessor::process_image(Mat img, float x1, float y1, float x2, float y2, float x3, float y3, float x4, float y4) {
+    return process_image(img, x1, y1, x2, y2, x3, y3, x4, y4, Enhancement());
+}
+
+Mat ImageProcessor::process_image(Mat img, float x1, float y1, float x2, float y2, float x3, float y3, float x4, float y4,
+                                  const Enhancement& enhancement) {
     // Remove the conversion to grayscale
-    Mat dst = ImageProcessor::crop_and_transform(img, x1, y1, x2, y2, x3, y3, x4, y4);
+    Mat dst = ImageProcessor::crop_and_transform(img, x1, y1, x2, y2, x3, y3, x4, y4, enhancement);
     return dst; // Return the cropped color image
 }
 
-Mat ImageProcessor::crop_and_transform(Mat img, float x1, float y1, float x2, float y2, float x3, float y3, float x4, float y4) {
+Mat ImageProcessor::crop_and_transform(Mat img, float x1, float y1, float x2, float y2, float x3, float y3, float x4, float y4,
+                                       const Enhancement& enhancement) {
     vector<Point2f> img_pts;
     img_pts.push_back(computePoint(x1, y1));
     img_pts.push_back(computePoint(x2, y2));
@@ -39,9 +45,6 @@ Mat ImageProcessor::crop_and_transform(Mat img, float x1, float y1, float x2, fl
     float width = maxX - minX;
     float height = maxY - minY;
 
-    // Set destination image size based on the bounding box
-    Mat dst = Mat::zeros(height, width, CV_8UC3);
-
     vector<Point2f> dst_pts;
     dst_pts.push_back(Point(0, 0));
     dst_pts.push_back(Point(width - 1, 0));
@@ -49,7 +52,199 @@ Mat ImageProcessor::crop_and_transform(Mat img, float x1, float y1, float x2, fl
     dst_pts.push_back(Point(width - 1, height - 1));
 
     Mat transformation_matrix = getPerspectiveTransform(img_pts, dst_pts);
-    warpPerspective(img, dst, transformation_matrix, dst.size());
+
+    // Destination size from the bounding box (truncated, as before)
+    return warp_banded(img, transformation_matrix, Size((int)width, (int)height), enhancement);
+}
+
+// Output rows per band: small enough that a band and the source rows it
+// samples stay cache-resident, large enough to amortize the per-band setup.
+static const int kBandRows = 64;
+
+// Background (paper brightness) map for the enhancement stage: one sample
+// per kBackgroundScale x kBackgroundScale output block, warped straight
+// from the source at that resolution. A max filter then drops the ink and
+// a blur smooths what is left, so each sample is the local paper
+// luminance.
+static const int kBackgroundScale = 16;
+
+// Below this share of the local background, binarization calls a pixel ink.
+static const float kInkLevel = 0.75f;
+
+// Weight of the 4-neighbour Laplacian added back by sharpening.
+static const float kSharpenAmount = 0.5f;
+
+static Mat background_map(const Mat& img, const Mat& srcToDst, Size size) {
+    const double s = kBackgroundScale;
+    Size small((size.width + kBackgroundScale - 1) / kBackgroundScale,
+               (size.height + kBackgroundScale - 1) / kBackgroundScale);
+
+    // Output pixel (x, y) lands at ((x + 0.5) / s - 0.5, ...) in the map.
+    Mat toSmall = (Mat_<double>(3, 3) << 1 / s, 0, 0.5 / s - 0.5, 0, 1 / s, 0.5 / s - 0.5, 0, 0, 1);
+    Mat color, gray;
+    warpPerspective(img, color, toSmall * srcToDst, small, INTER_LINEAR, BORDER_REPLICATE);
+    cvtColor(color, gray, COLOR_BGR2GRAY);
+    dilate(gray, gray, getStructuringElement(MORPH_RECT, Size(7, 7)));
+    GaussianBlur(gray, gray, Size(5, 5), 0);
+
+    Mat background;
+    gray.convertTo(background, CV_32F);
+    return background;
+}
+
+// Warps output rows [y0, y1) into `out` (resized to fit), reading only the
+// source rectangle those rows sample: a perspective map takes the rows'
+// rectangle to a quadrilateral, so its four mapped corners bound
+// everything they touch (plus a 2 px margin for the bilinear neighbours).
+static void warp_rows(const Mat& img, const Mat& dstToSrc, int width, int y0, int y1, Mat& out) {
+    out.create(y1 - y0, width, img.type());
+
+    vector<Point2f> corners = {
+        Point2f(0, (float)y0), Point2f((float)(width - 1), (float)y0),
+        Point2f(0, (float)(y1 - 1)), Point2f((float)(width - 1), (float)(y1 - 1))
+    };
+    vector<Point2f> mapped;
+    perspectiveTransform(corners, mapped, dstToSrc);
+
+    Rect roi = boundingRect(mapped);
+    roi = Rect(roi.x - 2, roi.y - 2, roi.width + 4, roi.height + 4) & Rect(0, 0, img.cols, img.rows);
+    if (roi.empty()) {
+        out.setTo(Scalar::all(0));
+        return;
+    }
+
+    // out(x, y) = img(roi)(shift * dstToSrc * down * (x, y))
+    Mat shift = (Mat_<double>(3, 3) << 1, 0, -roi.x, 0, 1, -roi.y, 0, 0, 1);
+    Mat down = (Mat_<double>(3, 3) << 1, 0, 0, 0, 1, y0, 0, 0, 1);
+    warpPerspective(img(roi), out, shift * dstToSrc * down, out.size(),
+                    INTER_LINEAR | WARP_INVERSE_MAP, BORDER_CONSTANT);
+}
+
+// warpPerspective(img, dst, srcToDst, size) computed in horizontal bands on
+// OpenCV's thread pool, with the optional enhancement fused in. Every
+// output pixel is written by exactly one band, so the output needs no zero
+// fill, and each band only reads the source rectangle it samples. Plain
+// warping samples the same as one full-size call, up to floating point
+// rounding in the composed per-band matrices.
+//
+// Enhancement runs on each band while it is still in cache, in one pass
+// per pixel: flatten (divide by the background map, bilinearly
+// interpolated), then sharpen (needs one halo row either side, warped with
+// the band), then binarize against kInkLevel of the background.
+Mat ImageProcessor::warp_banded(const Mat& img, const Mat& srcToDst, Size size, const Enhancement& enhancement) {
+    if (size.width <= 0 || size.height <= 0 || img.empty()) {
+        return Mat();
+    }
+
+    Mat dst(size, img.type());
+    Mat dstToSrc = srcToDst.inv();
+    const int bands = (size.height + kBandRows - 1) / kBandRows;
+
+    const bool enhance = img.type() == CV_8UC3 &&
+                         (enhancement.flatten || enhancement.binarize || enhancement.sharpen);
+    const bool needBackground = enhance && (enhancement.flatten || enhancement.binarize);
+
+    // Horizontal background interpolation is the same for every row.
+    Mat background;
+    vector<int> bx0, bx1;
+    vector<float> bwx;
+    if (needBackground) {
+        background = background_map(img, srcToDst, size);
+        bx0.resize(size.width);
+        bx1.resize(size.width);
+        bwx.resize(size.width);
+        for (int x = 0; x < size.width; x++) {
+            float fx = (x + 0.5f) / kBackgroundScale - 0.5f;
+            int i = cvFloor(fx);
+            bwx[x] = fx - i;
+            bx0[x] = std::min(std::max(i, 0), background.cols - 1);
+            bx1[x] = std::min(std::max(i + 1, 0), background.cols - 1);
+        }
+    }
+
+    auto backgroundRow = [&](int y, float* out) {
+        float fy = (y + 0.5f) / kBackgroundScale - 0.5f;
+        int i = cvFloor(fy);
+        float wy = fy - i;
+        const float* r0 = background.ptr<float>(std::min(std::max(i, 0), background.rows - 1));
+        const float* r1 = background.ptr<float>(std::min(std::max(i + 1, 0), background.rows - 1));
+        for (int x = 0; x < size.width; x++) {
+            float top = r0[bx0[x]] + bwx[x] * (r0[bx1[x]] - r0[bx0[x]]);
+            float bottom = r1[bx0[x]] + bwx[x] * (r1[bx1[x]] - r1[bx0[x]]);
+            out[x] = std::max(top + wy * (bottom - top), 1.0f);
+        }
+    };
+
+    parallel_for_(Range(0, bands), [&](const Range& range) {
+        Mat warped;
+        vector<float> bg(size.width);
+
+        for (int b = range.start; b < range.end; b++) {
+            const int y0 = b * kBandRows;
+            const int y1 = std::min(size.height, y0 + kBandRows);
+
+            if (!enhance) {
+                Mat band = dst.rowRange(y0, y1);
+                warp_rows(img, dstToSrc, size.width, y0, y1, band);
+                continue;
+            }
+
+            const int halo = enhancement.sharpen ? 1 : 0;
+            const int h0 = std::max(0, y0 - halo);
+            const int h1 = std::min(size.height, y1 + halo);
+            warp_rows(img, dstToSrc, size.width, h0, h1, warped);
+
+            if (enhancement.flatten) {
+                for (int y = h0; y < h1; y++) {
+                    backgroundRow(y, bg.data());
+                    uchar* p = warped.ptr<uchar>(y - h0);
+                    for (int x = 0; x < size.width; x++, p += 3) {
+                        float gain = 255.0f / bg[x];
+                        p[0] = saturate_cast<uchar>(p[0] * gain);
+                        p[1] = saturate_cast<uchar>(p[1] * gain);
+                        p[2] = saturate_cast<uchar>(p[2] * gain);
+                    }
+                }
+            }
+
+            for (int y = y0; y < y1; y++) {
+                const uchar* cur = warped.ptr<uchar>(y - h0);
+                const uchar* up = warped.ptr<uchar>(std::max(y - 1, h0) - h0);
+                const uchar* down = warped.ptr<uchar>(std::min(y + 1, h1 - 1) - h0);
+                uchar* out = dst.ptr<uchar>(y);
+
+                if (enhancement.binarize && !enhancement.flatten) {
+                    backgroundRow(y, bg.data());
+                }
+
+                for (int x = 0; x < size.width; x++) {
+                    const int c = 3 * x;
+                    const int l = x > 0 ? c - 3 : c;
+                    const int r = x + 1 < size.width ? c + 3 : c;
+                    float px[3];
+                    for (int k = 0; k < 3; k++) {
+                        px[k] = cur[c + k];
+                        if (enhancement.sharpen) {
+                            float laplacian = 4 * px[k] - up[c + k] - down[c + k] - cur[l + k] - cur[r + k];
+                            px[k] += kSharpenAmount * laplacian;
+                        }
+                    }
+
+                    if (enhancement.binarize) {
+                        // After flattening the paper is already at 255.
+                        float paper = enhancement.flatten ? 255.0f : bg[x];
+                        float luminance = 0.114f * px[0] + 0.587f * px[1] + 0.299f * px[2];
+                        uchar v = luminance < kInkLevel * paper ? 0 : 255;
+                        out[c] = out[c + 1] = out[c + 2] = v;
+                    } else {
+                        out[c] = saturate_cast<uchar>(px[0]);
+                        out[c + 1] = saturate_cast<uchar>(px[1]);
+                        out[c + 2] = saturate_cast<uchar>(px[2]);
+                    }
+                }
+            }
+        }
+    });
 
     return dst;
 }
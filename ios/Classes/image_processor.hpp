@@ -6,8 +6,19 @@ using namespace std;
 
 class ImageProcessor {
     public:
+    // Optional clean-up fused into the warp (applied in this order).
+    struct Enhancement {
+        bool flatten = false;   // divide out uneven lighting; paper goes white
+        bool sharpen = false;   // 3x3 Laplacian sharpening
+        bool binarize = false;  // adaptive black/white against the local paper level
+    };
+
     static Mat process_image(Mat img, float x1, float y1, float x2, float y2, float x3, float y3, float x4, float y4);
+    static Mat process_image(Mat img, float x1, float y1, float x2, float y2, float x3, float y3, float x4, float y4,
+                             const Enhancement& enhancement);
 
     private:
-    static Mat crop_and_transform(Mat img, float x1, float y1, float x2, float y2, float x3, float y3, float x4, float y4);
+    static Mat crop_and_transform(Mat img, float x1, float y1, float x2, float y2, float x3, float y3, float x4, float y4,
+                                  const Enhancement& enhancement);
+    static Mat warp_banded(const Mat& img, const Mat& srcToDst, Size size, const Enhancement& enhancement);
 };
@@ -1,7 +1,11 @@
 #include "native_edge_detection.hpp"
 #include "edge_detector.hpp"
 #include "image_processor.hpp"
+#include "image_buffer.hpp"
+#include "output_writer.hpp"
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <opencv2/opencv.hpp>
 
 
@@ -25,11 +29,7 @@ struct DetectionResult *create_detection_result(Coordinate *topLeft, Coordinate
     return detectionResult;
 }
 
-extern "C" __attribute__((visibility("default"))) __attribute__((used))
-struct DetectionResult *detect_edges(char *str) {
-    struct DetectionResult *coordinate = (struct DetectionResult *)malloc(sizeof(struct DetectionResult));
-    cv::Mat mat = cv::imread(str);
-
+static struct DetectionResult *detect_edges_in(cv::Mat& mat, const EdgeDetector::Options& options = EdgeDetector::Options()) {
     if (mat.size().width == 0 || mat.size().height == 0) {
         return create_detection_result(
             create_coordinate(0, 0),
@@ -39,7 +39,7 @@ struct DetectionResult *detect_edges(char *str) {
         );
     }
 
-    vector<cv::Point> points = EdgeDetector::detect_edges(mat);
+    vector<cv::Point> points = EdgeDetector::detect_edges(mat, options);
 
     return create_detection_result(
         create_coordinate((double)points[0].x / mat.size().width, (double)points[0].y / mat.size().height),
@@ -50,8 +50,138 @@ struct DetectionResult *detect_edges(char *str) {
 }
 
 extern "C" __attribute__((visibility("default"))) __attribute__((used))
-bool process_image(
-    char *path,
+struct DetectionResult *detect_edges(char *str) {
+    cv::Mat mat = cv::imread(str);
+    return detect_edges_in(mat);
+}
+
+// Pixel size from the file header (JPEG SOFn or PNG IHDR) without decoding
+// anything; 0x0 for other formats or a malformed header.
+static cv::Size image_size_from_header(const char *path) {
+    cv::Size size(0, 0);
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        return size;
+    }
+
+    unsigned char b[24];
+    if (fread(b, 1, 2, fp) == 2 && b[0] == 0xFF && b[1] == 0xD8) {
+        // Walk the marker segments up to the first start-of-frame.
+        for (;;) {
+            int c = fgetc(fp);
+            while (c == 0xFF) c = fgetc(fp);
+            if (c == EOF) break;
+            if (c == 0x01 || (c >= 0xD0 && c <= 0xD8)) continue; // no length
+            if (fread(b, 1, 2, fp) != 2) break;
+            long length = (b[0] << 8) | b[1];
+            bool sof = c >= 0xC0 && c <= 0xCF && c != 0xC4 && c != 0xC8 && c != 0xCC;
+            if (sof) {
+                if (fread(b, 1, 5, fp) == 5) {
+                    size = cv::Size((b[3] << 8) | b[4], (b[1] << 8) | b[2]);
+                }
+                break;
+            }
+            if (length < 2 || fseek(fp, length - 2, SEEK_CUR) != 0) break;
+        }
+    } else if (fseek(fp, 0, SEEK_SET) == 0 && fread(b, 1, 24, fp) == 24 &&
+               memcmp(b, "\x89PNG\r\n\x1a\n", 8) == 0 && memcmp(b + 12, "IHDR", 4) == 0) {
+        size = cv::Size((b[16] << 24) | (b[17] << 16) | (b[18] << 8) | b[19],
+                        (b[20] << 24) | (b[21] << 16) | (b[22] << 8) | b[23]);
+    }
+
+    fclose(fp);
+    return size;
+}
+
+// Loads path with its longer side at about working_size pixels. JPEGs are
+// decoded straight at 1/2, 1/4 or 1/8 scale where that still leaves at
+// least working_size (libjpeg skips most of the IDCT work); whatever is
+// still too large is area-resized down. working_size <= 0 = full size.
+static cv::Mat load_for_detection(const char *path, int working_size) {
+    int mode = cv::IMREAD_COLOR;
+    cv::Size full = image_size_from_header(path);
+    int longSide = std::max(full.width, full.height);
+    if (working_size > 0 && longSide > 0) {
+        if (longSide / 8 >= working_size) mode = cv::IMREAD_REDUCED_COLOR_8;
+        else if (longSide / 4 >= working_size) mode = cv::IMREAD_REDUCED_COLOR_4;
+        else if (longSide / 2 >= working_size) mode = cv::IMREAD_REDUCED_COLOR_2;
+    }
+
+    cv::Mat mat = cv::imread(path, mode);
+    longSide = std::max(mat.cols, mat.rows);
+    if (working_size > 0 && longSide > working_size) {
+        double scale = (double)working_size / longSide;
+        cv::resize(mat, mat, cv::Size(), scale, scale, cv::INTER_AREA);
+    }
+    return mat;
+}
+
+// Moves each normalized corner onto the strongest nearby corner of the
+// full-resolution image. A corner found at working resolution is only
+// known to within about one working pixel, so the search window spans
+// that many full-resolution pixels; refinements that leave it are
+// dropped.
+static void refine_corners(const char *path, struct DetectionResult *result, cv::Size working) {
+    cv::Mat gray = cv::imread(path, cv::IMREAD_GRAYSCALE);
+    if (gray.empty()) {
+        return;
+    }
+    double fullPerWorkingPixel = (double)std::max(gray.cols, gray.rows) / std::max(working.width, working.height);
+
+    Coordinate *corners[4] = { result->topLeft, result->topRight, result->bottomLeft, result->bottomRight };
+    std::vector<cv::Point2f> points;
+    for (Coordinate *c : corners) {
+        points.push_back(cv::Point2f((float)(c->x * gray.cols), (float)(c->y * gray.rows)));
+    }
+    std::vector<cv::Point2f> refined = points;
+
+    int half = std::max(3, (int)std::ceil(fullPerWorkingPixel * 2));
+    cv::cornerSubPix(gray, refined, cv::Size(half, half), cv::Size(-1, -1),
+                     cv::TermCriteria(cv::TermCriteria::EPS + cv::TermCriteria::COUNT, 20, 0.05));
+
+    for (int i = 0; i < 4; i++) {
+        cv::Point2f d = refined[i] - points[i];
+        if (std::abs(d.x) <= half && std::abs(d.y) <= half &&
+            refined[i].x >= 0 && refined[i].x <= gray.cols && refined[i].y >= 0 && refined[i].y <= gray.rows) {
+            corners[i]->x = refined[i].x / gray.cols;
+            corners[i]->y = refined[i].y / gray.rows;
+        }
+    }
+}
+
+// detect_edges at a reduced working resolution: the longer image side is
+// brought down to working_size pixels (0 = full resolution, as
+// detect_edges) before detection. Corners come back normalized, so they
+// need no rescaling. flags are EdgeDetectionFlags bits: with
+// EDGE_DETECTION_REFINE_CORNERS a found quad's corners are then refined on
+// the full-resolution image; EDGE_DETECTION_PARALLEL_LEVELS and
+// EDGE_DETECTION_EARLY_EXIT set the matching EdgeDetector::Options.
+extern "C" __attribute__((visibility("default"))) __attribute__((used))
+struct DetectionResult *detect_edges_with_options(char *path, int working_size, int flags) {
+    EdgeDetector::Options options;
+    options.parallelLevels = (flags & EDGE_DETECTION_PARALLEL_LEVELS) != 0;
+    options.earlyExit = (flags & EDGE_DETECTION_EARLY_EXIT) != 0;
+
+    cv::Mat mat = load_for_detection(path, working_size);
+    struct DetectionResult *result = detect_edges_in(mat, options);
+
+    bool found = !(result->topLeft->x == 0 && result->topLeft->y == 0 &&
+                   result->bottomRight->x == 1 && result->bottomRight->y == 1);
+    if ((flags & EDGE_DETECTION_REFINE_CORNERS) && found && !mat.empty()) {
+        refine_corners(path, result, mat.size());
+    }
+    return result;
+}
+
+// Same as detect_edges, on a raw camera frame (see image_buffer.hpp).
+extern "C" __attribute__((visibility("default"))) __attribute__((used))
+struct DetectionResult *detect_edges_buffer(const struct ImageBuffer *image) {
+    cv::Mat mat = image_from_buffer(image);
+    return detect_edges_in(mat);
+}
+
+static cv::Mat process_image_in(
+    cv::Mat& mat,
     double topLeftX,
     double topLeftY,
     double topRightX,
@@ -59,11 +189,15 @@ bool process_image(
     double bottomLeftX,
     double bottomLeftY,
     double bottomRightX,
-    double bottomRightY
+    double bottomRightY,
+    int enhance_flags = 0
 ) {
-    cv::Mat mat = cv::imread(path);
+    ImageProcessor::Enhancement enhancement;
+    enhancement.flatten = (enhance_flags & IMAGE_ENHANCE_FLATTEN) != 0;
+    enhancement.sharpen = (enhance_flags & IMAGE_ENHANCE_SHARPEN) != 0;
+    enhancement.binarize = (enhance_flags & IMAGE_ENHANCE_BINARIZE) != 0;
 
-    cv::Mat resizedMat = ImageProcessor::process_image(
+    return ImageProcessor::process_image(
         mat,
         topLeftX * mat.size().width,
         topLeftY * mat.size().height,
@@ -72,8 +206,127 @@ bool process_image(
         bottomLeftX * mat.size().width,
         bottomLeftY * mat.size().height,
         bottomRightX * mat.size().width,
-        bottomRightY * mat.size().height
+        bottomRightY * mat.size().height,
+        enhancement
     );
+}
+
+extern "C" __attribute__((visibility("default"))) __attribute__((used))
+bool process_image(
+    char *path,
+    double topLeftX,
+    double topLeftY,
+    double topRightX,
+    double topRightY,
+    double bottomLeftX,
+    double bottomLeftY,
+    double bottomRightX,
+    double bottomRightY
+) {
+    cv::Mat mat = cv::imread(path);
+
+    cv::Mat resizedMat = process_image_in(
+        mat,
+        topLeftX, topLeftY, topRightX, topRightY,
+        bottomLeftX, bottomLeftY, bottomRightX, bottomRightY
+    );
+    // Don't hold the decoded source through encoding.
+    mat.release();
+
+    return cv::imwrite(path, resizedMat);
+}
+
+// Same as process_image, with the enhancement stage selected by
+// enhance_flags (ImageEnhanceFlags bits; 0 = plain process_image) fused
+// into the warp.
+extern "C" __attribute__((visibility("default"))) __attribute__((used))
+bool process_image_enhanced(
+    char *path,
+    double topLeftX,
+    double topLeftY,
+    double topRightX,
+    double topRightY,
+    double bottomLeftX,
+    double bottomLeftY,
+    double bottomRightX,
+    double bottomRightY,
+    int enhance_flags
+) {
+    cv::Mat mat = cv::imread(path);
+
+    cv::Mat resizedMat = process_image_in(
+        mat,
+        topLeftX, topLeftY, topRightX, topRightY,
+        bottomLeftX, bottomLeftY, bottomRightX, bottomRightY,
+        enhance_flags
+    );
+    mat.release();
 
     return cv::imwrite(path, resizedMat);
-}
\ No newline at end of file
+}
+
+// Same as process_image, but the warped image is encoded and written back
+// to path on the writer thread (see output_writer.hpp; output_options sets
+// format/quality and may be NULL). Returns the handle to pass to
+// tlc_wait_output() before reading the file, or 0 if path couldn't be read.
+extern "C" __attribute__((visibility("default"))) __attribute__((used))
+int64_t process_image_async(
+    char *path,
+    double topLeftX,
+    double topLeftY,
+    double topRightX,
+    double topRightY,
+    double bottomLeftX,
+    double bottomLeftY,
+    double bottomRightX,
+    double bottomRightY,
+    const char *output_options
+) {
+    cv::Mat mat = cv::imread(path);
+    if (mat.empty()) {
+        return 0;
+    }
+
+    cv::Mat resizedMat = process_image_in(
+        mat,
+        topLeftX, topLeftY, topRightX, topRightY,
+        bottomLeftX, bottomLeftY, bottomRightX, bottomRightY
+    );
+    mat.release();
+
+    std::vector<OutputFile> files;
+    files.push_back(OutputFile{ resizedMat, path,
+                                parse_output_options(output_options ? output_options : "") });
+    return queue_outputs(std::move(files));
+}
+
+// Same as process_image, but reads a raw frame and writes the warped
+// result into the caller's output buffer instead of going through a file.
+// Returns false if the input is invalid or the output buffer is too small
+// (output->width/height then give the size needed).
+extern "C" __attribute__((visibility("default"))) __attribute__((used))
+bool process_image_buffer(
+    const struct ImageBuffer *image,
+    double topLeftX,
+    double topLeftY,
+    double topRightX,
+    double topRightY,
+    double bottomLeftX,
+    double bottomLeftY,
+    double bottomRightX,
+    double bottomRightY,
+    struct ImageBuffer *output
+) {
+    cv::Mat mat = image_from_buffer(image);
+    if (mat.empty()) {
+        return false;
+    }
+
+    cv::Mat resizedMat = process_image_in(
+        mat,
+        topLeftX, topLeftY, topRightX, topRightY,
+        bottomLeftX, bottomLeftY, bottomRightX, bottomRightY
+    );
+
+    return image_to_buffer(resizedMat, output);
+}
@@ -1,3 +1,8 @@
+#pragma once
+
+#include <stdint.h>
+#include "image_buffer.hpp"
+
 struct Coordinate
 {
     double x;
@@ -22,6 +27,17 @@ struct ProcessingInput
 extern "C"
 struct DetectionResult *detect_edges(char *str);
 
+// Flags for detect_edges_with_options
+enum EdgeDetectionFlags
+{
+    EDGE_DETECTION_REFINE_CORNERS = 1,  // sub-pixel corners on the full image
+    EDGE_DETECTION_PARALLEL_LEVELS = 2, // threshold levels on the thread pool
+    EDGE_DETECTION_EARLY_EXIT = 4       // stop at the first level with a dominant quad
+};
+
+extern "C"
+struct DetectionResult *detect_edges_with_options(char *path, int working_size, int flags);
+
 extern "C"
 bool process_image(
     char* path,
@@ -33,4 +49,60 @@ bool process_image(
     double bottomLeftY,
     double bottomRightX,
     double bottomRightY
-);
\ No newline at end of file
+);
+
+// Enhancement stage for process_image_enhanced. Selected steps always run
+// as flatten, then sharpen, then binarize.
+enum ImageEnhanceFlags
+{
+    IMAGE_ENHANCE_FLATTEN = 1,   // divide out uneven lighting; paper goes white
+    IMAGE_ENHANCE_BINARIZE = 2,  // black/white against the local paper level
+    IMAGE_ENHANCE_SHARPEN = 4    // 3x3 Laplacian sharpening
+};
+
+extern "C"
+bool process_image_enhanced(
+    char* path,
+    double topLeftX,
+    double topLeftY,
+    double topRightX,
+    double topRightY,
+    double bottomLeftX,
+    double bottomLeftY,
+    double bottomRightX,
+    double bottomRightY,
+    int enhance_flags
+);
+
+// Writes on the background writer thread; see output_writer.hpp
+extern "C"
+int64_t process_image_async(
+    char* path,
+    double topLeftX,
+    double topLeftY,
+    double topRightX,
+    double topRightY,
+    double bottomLeftX,
+    double bottomLeftY,
+    double bottomRightX,
+    double bottomRightY,
+    const char* output_options
+);
+
+// Raw-buffer variants (see image_buffer.hpp)
+extern "C"
+struct DetectionResult *detect_edges_buffer(const struct ImageBuffer *image);
+
+extern "C"
+bool process_image_buffer(
+    const struct ImageBuffer *image,
+    double topLeftX,
+    double topLeftY,
+    double topRightX,
+    double topRightY,
+    double bottomLeftX,
+    double bottomLeftY,
+    double bottomRightX,
+    double bottomRightY,
+    struct ImageBuffer *output
+);
@@ -3,15 +3,24 @@
 
 namespace AUCCalculator
 {
+    // Area under exp(-d^2 / 2) for |d| <= 4; scaling by sigma and yi gives
+    // the area of any peak generate_peak_data() would sample.
+    static const double kWindowArea = std::sqrt(2.0 * 3.14159265358979323846) * std::erf(4.0 / std::sqrt(2.0));
+
+    double peak_sigma(double area)
+    {
+        // Peak width now scales with the spot's pixel area instead of a
+        // fixed sigma — a physically bigger spot gets a broader Rf peak in
+        // the densitogram rather than every spot looking the same width.
+        return 0.003 + (area / 70000.0);
+    }
+
     void generate_peak_data(double xi, double yi, double area, std::vector<double>& peak_x, std::vector<double>& peak_y)
     {
         peak_x.resize(100);
         peak_y.resize(100);
 
-        // Peak width now scales with the spot's pixel area instead of a
-        // fixed sigma — a physically bigger spot gets a broader Rf peak in
-        // the densitogram rather than every spot looking the same width.
-        double sigma = 0.003 + (area / 70000.0);
+        double sigma = peak_sigma(area);
         double start_x = xi - 4.0 * sigma;
         double end_x = xi + 4.0 * sigma;
         double step = (end_x - start_x) / 99.0; // 100 points means 99 intervals
@@ -42,4 +51,17 @@ namespace AUCCalculator
         }
         return sum;
     }
-}
\ No newline at end of file
+
+    double peak_auc(double yi, double area)
+    {
+        return yi * peak_sigma(area) * kWindowArea;
+    }
+
+    void peak_auc(const double* intensity, const double* area, size_t count, double* out)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            out[i] = intensity[i] * peak_sigma(area[i]) * kWindowArea;
+        }
+    }
+}
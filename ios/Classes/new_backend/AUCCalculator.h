@@ -1,12 +1,28 @@
 #pragma once
 
+#include <cstddef>
 #include <vector>
 
 namespace AUCCalculator
 {
-    // Generate 100 points for x and y of a peak given its rf (xi), intensity (yi), and spot area
+    // Gaussian peak width for a spot of the given pixel area
+    double peak_sigma(double area);
+
+    // Generate 100 points for x and y of a peak given its rf (xi), intensity (yi), and spot area.
+    // Only needed to draw the densitogram; AUC values come from peak_auc().
     void generate_peak_data(double xi, double yi, double area, std::vector<double>& peak_x, std::vector<double>& peak_y);
 
     // Calculate Area Under Curve (AUC) using trapezoidal rule
     double calculate_auc(const std::vector<double>& x, const std::vector<double>& y);
-}
\ No newline at end of file
+
+    // Closed-form area of the peak generate_peak_data() samples: the
+    // Gaussian integrated over its +/-4 sigma window,
+    //   yi * sigma * sqrt(2*pi) * erf(4 / sqrt(2)).
+    // Agrees with the 100-point trapezoid to ~1e-6 relative (the
+    // trapezoid's own discretisation error) without sampling anything.
+    double peak_auc(double yi, double area);
+
+    // Batch form: out[i] = peak_auc(intensity[i], area[i]) for i < count.
+    // out must hold count doubles; it may alias neither input.
+    void peak_auc(const double* intensity, const double* area, size_t count, double* out);
+}
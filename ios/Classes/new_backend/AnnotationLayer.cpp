@@ -0,0 +1,231 @@
+#include "AnnotationLayer.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <list>
+#include <mutex>
+#include <tuple>
+#include <opencv2/imgproc.hpp>
+
+namespace AnnotationLayer
+{
+    namespace {
+        const int kFont = cv::FONT_HERSHEY_SIMPLEX;
+        const double kFontScale = 0.6;
+
+        // Layers kept at once; each holds a full-size annotated image.
+        const size_t kMaxLayers = 2;
+
+        struct Layer
+        {
+            std::string path;
+            long long fileSize;
+            long long mtime;
+            cv::Mat clean;
+            std::shared_ptr<cv::Mat> annotated;
+            std::vector<SpotMark> spots;
+
+            // clean may share its pixels with an ImageCache entry; it is
+            // counted anyway, since the layer keeps it alive after eviction.
+            size_t bytes() const {
+                return clean.total() * clean.elemSize() + annotated->total() * annotated->elemSize();
+            }
+        };
+
+        std::mutex& layers_mutex() {
+            static std::mutex m;
+            return m;
+        }
+
+        std::list<Layer>& layers() {
+            static std::list<Layer> l;
+            return l;
+        }
+
+        void label_text(const SpotMark& s, char* out, size_t size) {
+            std::snprintf(out, size, "%d Rf:%.2f", s.id, s.rf);
+        }
+
+        // What actually ends up on screen for a mark: integer box + label.
+        typedef std::tuple<int, int, int, int, std::string> Drawn;
+
+        Drawn drawn(const SpotMark& s) {
+            char label[64];
+            label_text(s, label, sizeof(label));
+            return Drawn(static_cast<int>(s.x1), static_cast<int>(s.y1),
+                         static_cast<int>(s.x2), static_cast<int>(s.y2), std::string(label));
+        }
+
+        std::shared_ptr<cv::Mat> full_render(const cv::Mat& clean, const std::vector<SpotMark>& spots) {
+            auto out = std::make_shared<cv::Mat>(clean.clone());
+            for (const auto& s : spots) {
+                draw_spot(*out, s);
+            }
+            return out;
+        }
+
+        // Drops the oldest layers until they fit in half the image-cache
+        // budget, and charges what is left to the cache.
+        void trim_locked(std::list<Layer>& all) {
+            size_t limit = ImageCache::shared().get_budget() / 2;
+            size_t total = 0;
+            for (const auto& l : all) total += l.bytes();
+            while (!all.empty() && (all.size() > kMaxLayers || total > limit)) {
+                total -= all.back().bytes();
+                all.pop_back();
+            }
+            ImageCache::shared().set_external_bytes(total);
+        }
+
+        // Grows the dirty regions until every mark's footprint is either
+        // fully inside one region or disjoint from all of them, merging
+        // regions that come to overlap.
+        void close_regions(std::vector<cv::Rect>& regions, const std::vector<cv::Rect>& marks) {
+            bool changed = true;
+            while (changed) {
+                changed = false;
+                for (auto& r : regions) {
+                    for (const auto& fp : marks) {
+                        if ((fp & r).area() > 0 && (fp | r) != r) {
+                            r |= fp;
+                            changed = true;
+                        }
+                    }
+                }
+                for (size_t i = 0; i < regions.size(); ++i) {
+                    for (size_t j = i + 1; j < regions.size();) {
+                        if ((regions[i] & regions[j]).area() > 0) {
+                            regions[i] |= regions[j];
+                            regions.erase(regions.begin() + j);
+                            changed = true;
+                        } else {
+                            ++j;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    void draw_spot(cv::Mat& image, const SpotMark& s, cv::Point offset)
+    {
+        cv::Point tl(static_cast<int>(s.x1), static_cast<int>(s.y1));
+        cv::Point br(static_cast<int>(s.x2), static_cast<int>(s.y2));
+        cv::rectangle(image, tl - offset, br - offset, cv::Scalar(0, 255, 0), 2);
+
+        char label[64];
+        label_text(s, label, sizeof(label));
+
+        int text_baseline = 0;
+        cv::Size textSize = cv::getTextSize(label, kFont, kFontScale, 1, &text_baseline);
+        cv::Point textOrg = cv::Point(tl.x, tl.y - 5) - offset;
+
+        cv::rectangle(image,
+                      textOrg + cv::Point(0, text_baseline),
+                      textOrg + cv::Point(textSize.width, -textSize.height),
+                      cv::Scalar(0, 255, 0),
+                      cv::FILLED);
+
+        cv::putText(image, label, textOrg, kFont, kFontScale, cv::Scalar(0, 0, 0), 1, cv::LINE_AA);
+    }
+
+    cv::Rect footprint(const SpotMark& s)
+    {
+        int x1 = static_cast<int>(s.x1), y1 = static_cast<int>(s.y1);
+        int x2 = static_cast<int>(s.x2), y2 = static_cast<int>(s.y2);
+
+        // Thickness-2 box strokes spill one pixel either side of the edge.
+        cv::Rect box(cv::Point(std::min(x1, x2) - 3, std::min(y1, y2) - 3),
+                     cv::Point(std::max(x1, x2) + 4, std::max(y1, y2) + 4));
+
+        char label[64];
+        label_text(s, label, sizeof(label));
+        int text_baseline = 0;
+        cv::Size textSize = cv::getTextSize(label, kFont, kFontScale, 1, &text_baseline);
+
+        // Label background spans [y1-5-h, y1-5+baseline]; anti-aliased
+        // glyph edges can reach a pixel or two past getTextSize().
+        cv::Rect text(cv::Point(x1 - 4, y1 - 5 - textSize.height - 4),
+                      cv::Point(x1 + textSize.width + 5, y1 - 5 + text_baseline + 5));
+        return box | text;
+    }
+
+    std::shared_ptr<const cv::Mat> render(const std::string& path,
+                                          const cv::Mat& clean,
+                                          const std::vector<SpotMark>& spots)
+    {
+        long long size = 0, mtime = 0;
+        if (path.empty() || !ImageCache::file_stamp(path, size, mtime)) {
+            return full_render(clean, spots);
+        }
+
+        std::lock_guard<std::mutex> lock(layers_mutex());
+        auto& all = layers();
+        auto it = std::find_if(all.begin(), all.end(), [&](const Layer& l) { return l.path == path; });
+
+        if (it == all.end() || it->fileSize != size || it->mtime != mtime || it->clean.size() != clean.size()) {
+            if (it != all.end()) all.erase(it);
+            std::shared_ptr<cv::Mat> annotated = full_render(clean, spots);
+            all.push_front(Layer{ path, size, mtime, clean, annotated, spots });
+            trim_locked(all);
+            return annotated;
+        }
+        all.splice(all.begin(), all, it);
+        Layer& layer = all.front();
+
+        // Marks that appear in only one of the two lists (as drawn, so a
+        // spot whose ID and box didn't change is left alone).
+        std::vector<Drawn> before, after;
+        for (const auto& s : layer.spots) before.push_back(drawn(s));
+        for (const auto& s : spots) after.push_back(drawn(s));
+        std::sort(before.begin(), before.end());
+        std::sort(after.begin(), after.end());
+
+        const cv::Rect bounds(0, 0, layer.clean.cols, layer.clean.rows);
+        std::vector<cv::Rect> regions;
+        auto mark_dirty = [&](const std::vector<SpotMark>& list, const std::vector<Drawn>& other) {
+            for (const auto& s : list) {
+                if (!std::binary_search(other.begin(), other.end(), drawn(s))) {
+                    cv::Rect r = footprint(s) & bounds;
+                    if (r.area() > 0) regions.push_back(r);
+                }
+            }
+        };
+        mark_dirty(layer.spots, after);
+        mark_dirty(spots, before);
+
+        if (!regions.empty()) {
+            std::vector<cv::Rect> marks;
+            marks.reserve(spots.size());
+            for (const auto& s : spots) marks.push_back(footprint(s) & bounds);
+            close_regions(regions, marks);
+
+            // Copy-on-write: an earlier caller may still be encoding it.
+            if (layer.annotated.use_count() > 1) {
+                layer.annotated = std::make_shared<cv::Mat>(layer.annotated->clone());
+            }
+
+            for (const auto& r : regions) {
+                cv::Mat roi = (*layer.annotated)(r);
+                layer.clean(r).copyTo(roi);
+                for (size_t i = 0; i < spots.size(); ++i) {
+                    if ((marks[i] & r).area() > 0) {
+                        draw_spot(roi, spots[i], r.tl());
+                    }
+                }
+            }
+        }
+
+        layer.spots = spots;
+        std::shared_ptr<cv::Mat> annotated = layer.annotated;
+        trim_locked(all); // the budget may have shrunk since the last call
+        return annotated;
+    }
+
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(layers_mutex());
+        layers().clear();
+        ImageCache::shared().set_external_bytes(0);
+    }
+}
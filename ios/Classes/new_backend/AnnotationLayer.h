@@ -0,0 +1,50 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <opencv2/core.hpp>
+
+#include "ImageCache.h"
+
+// Spot annotation (green box + "<id> Rf:<rf>" label) and the incremental
+// redraw add_manual_spots uses for interactive editing.
+//
+// Adding one box used to redraw every spot onto a fresh copy of the clean
+// image. Renumbering only changes the labels at or after the new spot's Rf
+// rank, so render() instead keeps the last annotated image per input and
+// only repaints the regions whose marks changed: each dirty region is
+// grown until it fully contains every mark touching it, restored from the
+// clean image, and those marks are redrawn in ID order. Drawing is
+// translation-invariant and nothing is clipped by a region edge, so the
+// result is pixel-identical to a full redraw.
+namespace AnnotationLayer
+{
+    struct SpotMark
+    {
+        int id;
+        double rf;
+        float x1, y1, x2, y2; // absolute image-pixel coordinates
+    };
+
+    // The one place a spot is drawn. offset is subtracted from every
+    // coordinate, for drawing into a sub-image.
+    void draw_spot(cv::Mat& image, const SpotMark& spot, cv::Point offset = cv::Point());
+
+    // Conservative bounds of every pixel draw_spot() can touch.
+    cv::Rect footprint(const SpotMark& spot);
+
+    // Annotated copy of the clean BGR image with `spots` drawn in order.
+    // With a non-empty path (the file clean was decoded from) the result
+    // is kept, and the next call for the same path, file size and mtime
+    // only repaints what changed. Kept layers are charged to the
+    // ImageCache budget (at most half of it; none when it is 0).
+    // The returned image is shared with the layer — read it, don't draw
+    // on it; the layer copies before modifying an image still in use.
+    std::shared_ptr<const cv::Mat> render(const std::string& path,
+                                          const cv::Mat& clean,
+                                          const std::vector<SpotMark>& spots);
+
+    // Drops every kept layer.
+    void clear();
+}
@@ -0,0 +1,181 @@
+#include "Densitogram.h"
+#include "AUCCalculator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <opencv2/imgproc.hpp>
+
+namespace Densitogram
+{
+    static const cv::Scalar kLaneColors[] = {
+        cv::Scalar(255, 128, 0), cv::Scalar(0, 200, 255), cv::Scalar(200, 0, 255),
+        cv::Scalar(255, 0, 128), cv::Scalar(128, 255, 0),
+    };
+
+    cv::Scalar lane_color(int laneId)
+    {
+        const int n = (int)(sizeof(kLaneColors) / sizeof(kLaneColors[0]));
+        return kLaneColors[((laneId - 1) % n + n) % n];
+    }
+
+    // Widest sigma the axis makes room for. A spot covering a large part
+    // of the plate would otherwise stretch the axis so far that every
+    // other peak collapses into a few pixels; its tails are simply clipped.
+    static const double kMaxAxisSigma = 0.05;
+
+    Axis axis_for(const std::vector<Peak>& peaks)
+    {
+        Axis axis = {0.0, 1.0};
+        for (const auto& p : peaks) {
+            if (!std::isfinite(p.rf)) continue;
+            double reach = 4.0 * std::min(AUCCalculator::peak_sigma(p.area), kMaxAxisSigma);
+            axis.lo = std::min(axis.lo, p.rf - reach);
+            axis.hi = std::max(axis.hi, p.rf + reach);
+        }
+        return axis;
+    }
+
+    // Grid spacing of 1, 2 or 5 times a power of ten giving at most about
+    // ten intervals over range (0.1 for the usual [0, 1] axis).
+    static double tick_step(double range)
+    {
+        double raw = range / 10.0;
+        double magnitude = std::pow(10.0, std::floor(std::log10(raw)));
+        for (double m : {1.0, 2.0, 5.0}) {
+            if (m * magnitude >= raw * (1.0 - 1e-9)) return m * magnitude;
+        }
+        return 10.0 * magnitude;
+    }
+
+    cv::Mat accumulate(const std::vector<Peak>& peaks, int laneCount, const Axis& axis, int resolution)
+    {
+        cv::Mat profiles = cv::Mat::zeros(std::max(laneCount, 1), std::max(resolution, 2), CV_32F);
+        const double step = (axis.hi - axis.lo) / (profiles.cols - 1);
+        if (!(step > 0.0)) return profiles;
+
+        cv::Mat window;
+        for (const auto& p : peaks) {
+            if (p.lane < 0 || p.lane >= profiles.rows || !std::isfinite(p.rf)) continue;
+
+            double sigma = AUCCalculator::peak_sigma(p.area);
+            if (!(sigma > 0.0) || !std::isfinite(sigma)) continue;
+
+            // Clamped in double first: the window of a very wide peak can
+            // run far past the axis (see kMaxAxisSigma).
+            double first = std::ceil((p.rf - 4.0 * sigma - axis.lo) / step);
+            double last = std::floor((p.rf + 4.0 * sigma - axis.lo) / step);
+            if (last < 0.0 || first > profiles.cols - 1) continue;
+            int b0 = (int)std::max(first, 0.0);
+            int b1 = (int)std::min(last, (double)(profiles.cols - 1));
+            if (b1 < b0) continue;
+
+            // Exponent for every bin in the window, then one SIMD exp and
+            // one scaled add into this lane's row.
+            window.create(1, b1 - b0 + 1, CV_32F);
+            float* w = window.ptr<float>();
+            const double inv = -1.0 / (2.0 * sigma * sigma);
+            for (int k = 0; k < window.cols; ++k) {
+                double d = axis.lo + (b0 + k) * step - p.rf;
+                w[k] = (float)(d * d * inv);
+            }
+            cv::exp(window, window);
+
+            cv::Mat span = profiles.row(p.lane).colRange(b0, b1 + 1);
+            cv::scaleAdd(window, p.intensity, span, span);
+        }
+        return profiles;
+    }
+
+    cv::Mat render(const std::vector<Peak>& peaks, int laneCount, const Options& options)
+    {
+        const int width = std::max(options.width, 200);
+        const int height = std::max(options.height, 150);
+        cv::Mat canvas(height, width, CV_8UC3, cv::Scalar(255, 255, 255));
+
+        Axis axis = axis_for(peaks);
+        cv::Mat profiles = accumulate(peaks, laneCount, axis, options.resolution);
+
+        cv::Mat total;
+        cv::reduce(profiles, total, 0, cv::REDUCE_SUM, CV_32F);
+
+        double ymax = 0.0;
+        cv::minMaxLoc(total, nullptr, &ymax);
+        if (!(ymax > 0.0)) ymax = 1.0;
+        ymax *= 1.1; // headroom for apex labels
+
+        // Plot area
+        const int left = 60, right = 20, top = 30, bottom = 45;
+        const cv::Rect plot(left, top, width - left - right, height - top - bottom);
+        const cv::Scalar axisColor(0, 0, 0);
+        const cv::Scalar gridColor(225, 225, 225);
+
+        auto to_x = [&](double rf) {
+            return plot.x + (int)std::lround((rf - axis.lo) / (axis.hi - axis.lo) * (plot.width - 1));
+        };
+        auto to_y = [&](double v) {
+            return plot.y + plot.height - 1 - (int)std::lround(v / ymax * (plot.height - 1));
+        };
+
+        // Rf grid + tick labels inside the axis range, spaced to suit it
+        char label[32];
+        const double tick = tick_step(axis.hi - axis.lo);
+        const int decimals = std::max(0, (int)-std::floor(std::log10(tick) + 1e-9));
+        const double firstTick = std::ceil(axis.lo / tick - 1e-9);
+        const double lastTick = std::floor(axis.hi / tick + 1e-9);
+        for (double t = firstTick; std::isfinite(tick) && t <= lastTick; t += 1.0) {
+            int x = to_x(t * tick);
+            cv::line(canvas, cv::Point(x, plot.y), cv::Point(x, plot.y + plot.height - 1), gridColor, 1);
+            std::snprintf(label, sizeof(label), "%.*f", decimals, t * tick);
+            cv::putText(canvas, label, cv::Point(x - 12, plot.y + plot.height + 18),
+                        cv::FONT_HERSHEY_SIMPLEX, 0.45, axisColor, 1, cv::LINE_AA);
+        }
+        cv::rectangle(canvas, plot, axisColor, 1);
+        cv::putText(canvas, "Rf", cv::Point(plot.x + plot.width / 2 - 8, height - 6),
+                    cv::FONT_HERSHEY_SIMPLEX, 0.5, axisColor, 1, cv::LINE_AA);
+        cv::putText(canvas, "Intensity", cv::Point(4, plot.y - 10),
+                    cv::FONT_HERSHEY_SIMPLEX, 0.5, axisColor, 1, cv::LINE_AA);
+
+        // Curves: one polyline per lane, plus the summed profile in black
+        // when several lanes share the plot.
+        std::vector<cv::Point> pts(profiles.cols);
+        auto draw_row = [&](const float* row, const cv::Scalar& color, int thickness) {
+            for (int k = 0; k < profiles.cols; ++k) {
+                double rf = axis.lo + (axis.hi - axis.lo) * k / (profiles.cols - 1);
+                pts[k] = cv::Point(to_x(rf), to_y(row[k]));
+            }
+            cv::polylines(canvas, pts, false, color, thickness, cv::LINE_AA);
+        };
+
+        for (int lane = 0; lane < profiles.rows; ++lane) {
+            draw_row(profiles.ptr<float>(lane), lane_color(lane + 1), 2);
+        }
+        if (profiles.rows > 1) {
+            draw_row(total.ptr<float>(), axisColor, 1);
+        }
+
+        // Per-spot apex markers, placed on their own lane's curve
+        const double step = (axis.hi - axis.lo) / (profiles.cols - 1);
+        for (const auto& p : peaks) {
+            if (p.spotId <= 0 || p.lane < 0 || p.lane >= profiles.rows || !std::isfinite(p.rf)) continue;
+            int bin = std::max(0, std::min(profiles.cols - 1, (int)std::lround((p.rf - axis.lo) / step)));
+            cv::Point apex(to_x(p.rf), to_y(profiles.at<float>(p.lane, bin)));
+            std::snprintf(label, sizeof(label), "%d", p.spotId);
+            cv::putText(canvas, label, apex + cv::Point(-4, -6),
+                        cv::FONT_HERSHEY_SIMPLEX, 0.4, lane_color(p.lane + 1), 1, cv::LINE_AA);
+        }
+
+        // Lane legend
+        if (profiles.rows > 1) {
+            for (int lane = 0; lane < profiles.rows; ++lane) {
+                cv::Point org(plot.x + plot.width - 80, plot.y + 18 + 18 * lane);
+                cv::line(canvas, org + cv::Point(0, -4), org + cv::Point(18, -4), lane_color(lane + 1), 2);
+                std::snprintf(label, sizeof(label), "Lane %d", lane + 1);
+                cv::putText(canvas, label, org + cv::Point(24, 0),
+                            cv::FONT_HERSHEY_SIMPLEX, 0.45, axisColor, 1, cv::LINE_AA);
+            }
+        }
+
+        return canvas;
+    }
+}
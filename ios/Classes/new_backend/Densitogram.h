@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vector>
+#include <opencv2/core.hpp>
+
+// Native densitogram renderer.
+//
+// Every spot contributes the same Gaussian peak AUCCalculator integrates
+// (height = intensity, width = peak_sigma(area), truncated at +/-4 sigma).
+// Peaks are summed per lane onto one shared Rf axis in a fixed-resolution
+// float buffer, then the per-lane curves (and their total, when there is
+// more than one lane) are rasterized straight into a BGR cv::Mat — no
+// per-spot sample vectors and no JSON round-trip to plot on the Dart side.
+namespace Densitogram
+{
+    struct Peak
+    {
+        int lane;         // 0-based row in the accumulation buffer
+        int spotId;       // drawn at the peak's apex; <= 0 for no label
+        double rf;
+        double intensity;
+        double area;      // spot box area in pixels (drives peak width)
+    };
+
+    struct Options
+    {
+        int resolution = 1024; // samples along the Rf axis
+        int width = 1200;      // output image size in pixels
+        int height = 600;
+    };
+
+    // Rf range covered by the plot: [0, 1], widened to take in every
+    // peak's +/-4 sigma window (sigma capped, so one very large spot can't
+    // flatten the rest of the plot; non-finite Rf values are ignored).
+    struct Axis
+    {
+        double lo;
+        double hi;
+    };
+
+    Axis axis_for(const std::vector<Peak>& peaks);
+
+    // Sums peaks into a laneCount x resolution CV_32F buffer sampled
+    // evenly over axis. Each peak only touches the bins inside its own
+    // window, evaluated with one vectorized cv::exp per peak.
+    cv::Mat accumulate(const std::vector<Peak>& peaks, int laneCount, const Axis& axis, int resolution);
+
+    // Accumulates and rasterizes the whole plot (CV_8UC3, white background).
+    cv::Mat render(const std::vector<Peak>& peaks, int laneCount, const Options& options = Options());
+
+    // Lane colour shared by the annotated image and the plot (BGR).
+    cv::Scalar lane_color(int laneId);
+}
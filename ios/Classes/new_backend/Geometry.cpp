@@ -0,0 +1,168 @@
+#include "Geometry.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Geometry
+{
+    PixelBox to_pixel_box(double x1, double y1, double x2, double y2)
+    {
+        int ix1 = (int)x1, iy1 = (int)y1, ix2 = (int)x2, iy2 = (int)y2;
+        PixelBox b;
+        b.x1 = std::min(ix1, ix2);
+        b.y1 = std::min(iy1, iy2);
+        b.x2 = std::max(ix1, ix2);
+        b.y2 = std::max(iy1, iy2);
+        return b;
+    }
+
+    double box_overlap_percent(const PixelBox& a, const PixelBox& b)
+    {
+        double area_a = (double)(a.x2 - a.x1 + 1) * (a.y2 - a.y1 + 1);
+        double area_b = (double)(b.x2 - b.x1 + 1) * (b.y2 - b.y1 + 1);
+        double min_area = std::min(area_a, area_b);
+
+        int iw = std::min(a.x2, b.x2) - std::max(a.x1, b.x1) + 1;
+        int ih = std::min(a.y2, b.y2) - std::max(a.y1, b.y1) + 1;
+        if (iw <= 0 || ih <= 0) return 0.0;
+
+        double intersection = (double)iw * ih;
+        return (intersection / min_area) * 100.0;
+    }
+
+    namespace
+    {
+        // A quad clipped by four half-planes has at most 8 vertices.
+        const int kMaxClipVertices = 8;
+
+        double signed_area(const cv::Point2d* pts, int n)
+        {
+            double sum = 0.0;
+            for (int i = 0; i < n; ++i) {
+                const cv::Point2d& p = pts[i];
+                const cv::Point2d& q = pts[(i + 1) % n];
+                sum += p.x * q.y - q.x * p.y;
+            }
+            return 0.5 * sum;
+        }
+
+        // > 0 when p is left of the directed edge a->b.
+        double side(const cv::Point2d& a, const cv::Point2d& b, const cv::Point2d& p)
+        {
+            return (b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x);
+        }
+
+        cv::Point2d intersect(const cv::Point2d& p, const cv::Point2d& q, double sp, double sq)
+        {
+            double t = sp / (sp - sq);
+            return cv::Point2d(p.x + t * (q.x - p.x), p.y + t * (q.y - p.y));
+        }
+    }
+
+    double quad_overlap_percent(const cv::Point2d a[4], const cv::Point2d b[4])
+    {
+        double area_a = std::abs(signed_area(a, 4));
+        double area_b = std::abs(signed_area(b, 4));
+        double min_area = std::min(area_a, area_b);
+        if (min_area <= 0.0) return 0.0;
+
+        // Sutherland–Hodgman: clip `a` against each edge of `b`, walked
+        // counter-clockwise so "inside" is always the left-hand side.
+        cv::Point2d clip[4];
+        bool ccw = signed_area(b, 4) > 0.0;
+        for (int i = 0; i < 4; ++i) {
+            clip[i] = ccw ? b[i] : b[3 - i];
+        }
+
+        cv::Point2d buf_a[kMaxClipVertices];
+        cv::Point2d buf_b[kMaxClipVertices];
+        cv::Point2d* cur = buf_a;
+        cv::Point2d* nxt = buf_b;
+        int n = 4;
+        for (int i = 0; i < 4; ++i) cur[i] = a[i];
+
+        for (int e = 0; e < 4 && n > 0; ++e) {
+            const cv::Point2d& ea = clip[e];
+            const cv::Point2d& eb = clip[(e + 1) % 4];
+            int m = 0;
+            for (int i = 0; i < n; ++i) {
+                const cv::Point2d& p = cur[i];
+                const cv::Point2d& q = cur[(i + 1) % n];
+                double sp = side(ea, eb, p);
+                double sq = side(ea, eb, q);
+                if (sp >= 0.0) {
+                    if (m < kMaxClipVertices) nxt[m++] = p;
+                    if (sq < 0.0 && m < kMaxClipVertices) nxt[m++] = intersect(p, q, sp, sq);
+                } else if (sq >= 0.0 && m < kMaxClipVertices) {
+                    nxt[m++] = intersect(p, q, sp, sq);
+                }
+            }
+            std::swap(cur, nxt);
+            n = m;
+        }
+
+        if (n < 3) return 0.0;
+        double intersection = std::abs(signed_area(cur, n));
+        return (intersection / min_area) * 100.0;
+    }
+
+    YSweepIndex::YSweepIndex(const std::vector<PixelBox>& boxes_)
+        : boxes(&boxes_), maxHeight(0)
+    {
+        order.resize(boxes_.size());
+        for (size_t i = 0; i < order.size(); ++i) order[i] = (int)i;
+        std::sort(order.begin(), order.end(), [&](int a, int b) {
+            return boxes_[a].y1 < boxes_[b].y1;
+        });
+
+        sortedY1.reserve(order.size());
+        for (int idx : order) {
+            sortedY1.push_back(boxes_[idx].y1);
+            maxHeight = std::max(maxHeight, boxes_[idx].y2 - boxes_[idx].y1);
+        }
+    }
+
+    void YSweepIndex::query(const PixelBox& q, std::vector<int>& out) const
+    {
+        out.clear();
+
+        // A box can only reach down to q.y1 if it starts no more than
+        // maxHeight above it, and must start no lower than q.y2.
+        auto lo = std::lower_bound(sortedY1.begin(), sortedY1.end(), q.y1 - maxHeight);
+        auto hi = std::upper_bound(sortedY1.begin(), sortedY1.end(), q.y2);
+
+        for (auto it = lo; it < hi; ++it) {
+            int idx = order[it - sortedY1.begin()];
+            const PixelBox& b = (*boxes)[idx];
+            if (b.y2 >= q.y1 && b.x1 <= q.x2 && b.x2 >= q.x1) {
+                out.push_back(idx);
+            }
+        }
+        std::sort(out.begin(), out.end());
+    }
+
+    MatchResult match_overlaps(const std::vector<PixelBox>& rows, const std::vector<PixelBox>& cols)
+    {
+        MatchResult res;
+        res.bestIndex.assign(rows.size(), -1);
+        res.bestOverlap.assign(rows.size(), 0.0);
+        if (rows.empty() || cols.empty()) return res;
+
+        YSweepIndex index(cols);
+        std::vector<int> candidates;
+
+        for (size_t i = 0; i < rows.size(); ++i) {
+            index.query(rows[i], candidates);
+            for (int j : candidates) {
+                double ov = box_overlap_percent(rows[i], cols[j]);
+                if (ov <= 0.0) continue;
+                res.nonzeroOverlaps.push_back(ov);
+                if (ov > res.bestOverlap[i]) {
+                    res.bestOverlap[i] = ov;
+                    res.bestIndex[i] = j;
+                }
+            }
+        }
+        return res;
+    }
+}
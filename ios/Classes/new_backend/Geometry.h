@@ -0,0 +1,73 @@
+#pragma once
+
+#include <vector>
+#include <opencv2/core.hpp>
+
+// Overlap geometry for manual-vs-detected spot matching.
+//
+// The matcher used to rasterize both boxes into scratch masks with
+// fillPoly and count pixels — two mask allocations, two fills and three
+// countNonZero passes per pair. Every box it is ever given is an
+// axis-aligned rectangle, so overlaps are computed analytically here
+// instead, with results identical to the rasterized version (fillPoly
+// covers a rectangle's boundary pixels too, so areas are counted on
+// inclusive integer bounds). General convex quads get an exact polygon
+// intersection for callers that need one.
+namespace Geometry
+{
+    // Axis-aligned box on integer pixel bounds, inclusive on every edge —
+    // the same pixel set fillPoly paints for that rectangle.
+    struct PixelBox
+    {
+        int x1;
+        int y1;
+        int x2;
+        int y2;
+    };
+
+    // Truncates to int (as the old box_to_quad did) and orders the bounds.
+    PixelBox to_pixel_box(double x1, double y1, double x2, double y2);
+
+    // Overlap as a percentage of the smaller box's pixel area.
+    double box_overlap_percent(const PixelBox& a, const PixelBox& b);
+
+    // Exact intersection area of two convex quads (either winding), as a
+    // percentage of the smaller quad's area. Degenerate quads give 0.
+    double quad_overlap_percent(const cv::Point2d a[4], const cv::Point2d b[4]);
+
+    // Sorted-interval sweep over y. Spots within a lane are spread out
+    // vertically, so sorting boxes by top edge and bounding the search
+    // window by the tallest box means a query only visits boxes whose
+    // vertical span can reach it, instead of every box in the lane.
+    class YSweepIndex
+    {
+    public:
+        // Keeps a pointer to `boxes`, which must outlive the index.
+        explicit YSweepIndex(const std::vector<PixelBox>& boxes);
+
+        // Replaces `out` with the indices (ascending) of every box sharing
+        // at least one pixel with q.
+        void query(const PixelBox& q, std::vector<int>& out) const;
+
+    private:
+        const std::vector<PixelBox>* boxes;
+        std::vector<int> order;   // box indices sorted by y1
+        std::vector<int> sortedY1;
+        int maxHeight;
+    };
+
+    struct MatchResult
+    {
+        std::vector<double> nonzeroOverlaps; // row-major order, zeros omitted
+        std::vector<int> bestIndex;          // per row; -1 if nothing overlaps
+        std::vector<double> bestOverlap;     // per row; 0 if nothing overlaps
+    };
+
+    // Overlap of every row box with every column box (box_overlap_percent)
+    // plus a per-row argmax, evaluating only pairs that actually intersect.
+    // nonzeroOverlaps lists the non-zero entries of the full rows x cols
+    // matrix in row-major order, and bestIndex is the lowest column
+    // achieving a row's maximum — the same values a dense scan over every
+    // pair would give.
+    MatchResult match_overlaps(const std::vector<PixelBox>& rows, const std::vector<PixelBox>& cols);
+}
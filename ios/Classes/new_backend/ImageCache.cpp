@@ -0,0 +1,140 @@
+#include "ImageCache.h"
+
+#include <sys/stat.h>
+#include <cstdio>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+
+#ifdef __ANDROID__
+#include <android/log.h>
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, "C++_Backend", __VA_ARGS__)
+#else
+#define LOGI(...) printf(__VA_ARGS__); printf("\n")
+#endif
+
+std::shared_ptr<DecodedImage> DecodedImage::from_bgr(const cv::Mat& bgr)
+{
+    auto img = std::make_shared<DecodedImage>();
+    img->bgr = bgr;
+    cv::Mat gray;
+    cv::cvtColor(bgr, gray, cv::COLOR_BGR2GRAY);
+    img->intensity = IntensityTable(gray);
+    return img;
+}
+
+size_t DecodedImage::bytes() const
+{
+    return bgr.total() * bgr.elemSize() + intensity.bytes();
+}
+
+bool ImageCache::file_stamp(const std::string& path, long long& size, long long& mtime)
+{
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) return false;
+    size = static_cast<long long>(st.st_size);
+#if defined(__APPLE__)
+    mtime = static_cast<long long>(st.st_mtimespec.tv_sec) * 1000000000LL + st.st_mtimespec.tv_nsec;
+#elif defined(__linux__)
+    mtime = static_cast<long long>(st.st_mtim.tv_sec) * 1000000000LL + st.st_mtim.tv_nsec;
+#else
+    mtime = static_cast<long long>(st.st_mtime) * 1000000000LL;
+#endif
+    return true;
+}
+
+ImageCache& ImageCache::shared()
+{
+    static ImageCache cache;
+    return cache;
+}
+
+std::shared_ptr<const DecodedImage> ImageCache::load(const std::string& path, bool keep)
+{
+    long long size = 0, mtime = 0;
+    if (!file_stamp(path, size, mtime)) return nullptr;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = index.find(path);
+        if (it != index.end()) {
+            if (it->second->fileSize == size && it->second->mtime == mtime) {
+                lru.splice(lru.begin(), lru, it->second);
+                return it->second->image;
+            }
+            used -= it->second->bytes;
+            lru.erase(it->second);
+            index.erase(it);
+        }
+    }
+
+    // Decode outside the lock: a second thread racing on the same path
+    // only costs a duplicate decode, not a stall for every other lookup.
+    cv::Mat bgr = cv::imread(path, cv::IMREAD_COLOR);
+    if (bgr.empty()) return nullptr;
+    std::shared_ptr<const DecodedImage> image = DecodedImage::from_bgr(bgr);
+    if (!keep) return image;
+
+    size_t bytes = image->bytes();
+    std::lock_guard<std::mutex> lock(mutex);
+    if (bytes > budget) {
+        if (budget > 0) {
+            LOGI("ImageCache: %s needs %zu MB, over the %zu MB budget; not cached (raise image_cache=).",
+                 path.c_str(), bytes >> 20, budget >> 20);
+        }
+        return image;
+    }
+    if (index.count(path)) return image;
+
+    lru.push_front(Entry{ path, size, mtime, bytes, image });
+    index[path] = lru.begin();
+    used += bytes;
+    evict_locked();
+    return image;
+}
+
+void ImageCache::invalidate(const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = index.find(path);
+    if (it == index.end()) return;
+    used -= it->second->bytes;
+    lru.erase(it->second);
+    index.erase(it);
+}
+
+void ImageCache::set_budget(size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    budget = bytes;
+    evict_locked();
+}
+
+size_t ImageCache::get_budget()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return budget;
+}
+
+void ImageCache::set_external_bytes(size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    external = bytes;
+    evict_locked();
+}
+
+void ImageCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    lru.clear();
+    index.clear();
+    used = 0;
+}
+
+void ImageCache::evict_locked()
+{
+    while (used + external > budget && !lru.empty()) {
+        used -= lru.back().bytes;
+        index.erase(lru.back().path);
+        lru.pop_back();
+    }
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <opencv2/core.hpp>
+
+#include "IntensityTable.h"
+
+// One decoded input image plus everything derived from it that the TLC
+// pipeline reads: the summed-area table of its gray plane (the plane
+// itself isn't kept). About 7 bytes per pixel, ~84 MB for a 12 MP plate.
+struct DecodedImage
+{
+    cv::Mat bgr;  // shared between callers — clone before drawing on it
+    IntensityTable intensity;
+
+    static std::shared_ptr<DecodedImage> from_bgr(const cv::Mat& bgr);
+    size_t bytes() const;
+};
+
+// Process-wide LRU cache of decoded images, so interactive spot editing
+// (add_manual_spots once per drawn box, always on the same plate) doesn't
+// pay a full JPEG decode + gray conversion per tap.
+//
+// Entries are keyed by path and revalidated against the file's size and
+// mtime on every lookup, like the model session registry; writers that
+// overwrite a file they may have read should also invalidate() it, since
+// mtime resolution can be coarse. Total size is bounded by a byte budget
+// (least recently used entries go first); an image bigger than the whole
+// budget is decoded and returned but not kept (and logged, since every
+// call on it then decodes again). The default fits a 12 MP plate with room
+// for its annotation layer (AnnotationLayer.h), which is charged to the
+// same budget.
+class ImageCache
+{
+public:
+    static constexpr size_t kDefaultBudget = 192u * 1024u * 1024u;
+
+    static ImageCache& shared();
+
+    // Decoded image for path, decoding on a miss. nullptr if unreadable.
+    // With keep = false a miss is decoded but not inserted — for callers
+    // about to overwrite the file, whose entry would only be invalidated.
+    std::shared_ptr<const DecodedImage> load(const std::string& path, bool keep = true);
+
+    void invalidate(const std::string& path);
+
+    // 0 disables caching. Evicts immediately if the new budget is smaller.
+    void set_budget(size_t bytes);
+    size_t get_budget();
+
+    // Bytes held elsewhere that count against the same budget (the
+    // annotation layers); cached images are evicted to make room.
+    void set_external_bytes(size_t bytes);
+
+    void clear();
+
+    // Size and modification time (ns where the platform has it) of path;
+    // false if it can't be stat'ed.
+    static bool file_stamp(const std::string& path, long long& size, long long& mtime);
+
+private:
+    struct Entry
+    {
+        std::string path;
+        long long fileSize;
+        long long mtime;
+        size_t bytes;
+        std::shared_ptr<const DecodedImage> image;
+    };
+
+    void evict_locked();
+
+    std::mutex mutex;
+    std::list<Entry> lru; // most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> index;
+    size_t budget = kDefaultBudget;
+    size_t used = 0;
+    size_t external = 0;
+};
@@ -0,0 +1,87 @@
+#include "IntensityTable.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <opencv2/core.hpp>
+
+IntensityTable::IntensityTable(const cv::Mat& gray, bool withVariance)
+    : width(gray.cols), height(gray.rows)
+{
+    CV_Assert(gray.type() == CV_8UC1);
+
+    // Built here rather than with cv::integral: a CV_32S table of a bright
+    // plate past ~8.4 MP exceeds INT_MAX, and cv::integral accumulates in
+    // signed int (undefined on overflow; other backends may saturate).
+    // Accumulating in uint32_t makes the wrap-around defined, and box_sum()
+    // combines corners in the same modulo-2^32 arithmetic, where it cancels
+    // out. A box's sum is exact as long as the box itself sums to less than
+    // 2^32 (about 16.8 MP of pure white), at half the size of a CV_64F table.
+    sum = cv::Mat::zeros(height + 1, width + 1, CV_32S);
+    if (withVariance) {
+        sqsum = cv::Mat::zeros(height + 1, width + 1, CV_64F);
+    }
+
+    for (int y = 0; y < height; ++y) {
+        const uchar* src = gray.ptr<uchar>(y);
+        const uint32_t* above = sum.ptr<uint32_t>(y) + 1;
+        uint32_t* row = sum.ptr<uint32_t>(y + 1) + 1;
+        uint32_t run = 0;
+        for (int x = 0; x < width; ++x) {
+            run += src[x];
+            row[x] = above[x] + run;
+        }
+
+        if (withVariance) {
+            const double* sqAbove = sqsum.ptr<double>(y) + 1;
+            double* sqRow = sqsum.ptr<double>(y + 1) + 1;
+            double sqRun = 0.0;
+            for (int x = 0; x < width; ++x) {
+                sqRun += (double)(src[x] * src[x]);
+                sqRow[x] = sqAbove[x] + sqRun;
+            }
+        }
+    }
+}
+
+bool IntensityTable::clamp(int& x1, int& y1, int& x2, int& y2) const
+{
+    x1 = std::max(0, x1);
+    y1 = std::max(0, y1);
+    x2 = std::min(width, x2);
+    y2 = std::min(height, y2);
+    return x2 > x1 && y2 > y1;
+}
+
+double IntensityTable::box_sum(int x1, int y1, int x2, int y2) const
+{
+    // Modulo-2^32 corner combination; see the constructor.
+    const uint32_t* top = sum.ptr<uint32_t>(y1);
+    const uint32_t* bot = sum.ptr<uint32_t>(y2);
+    uint32_t s = bot[x2] - bot[x1] - top[x2] + top[x1];
+    return (double)s;
+}
+
+int IntensityTable::count(int x1, int y1, int x2, int y2) const
+{
+    if (empty() || !clamp(x1, y1, x2, y2)) return 0;
+    return (x2 - x1) * (y2 - y1);
+}
+
+double IntensityTable::mean(int x1, int y1, int x2, int y2) const
+{
+    if (empty() || !clamp(x1, y1, x2, y2)) return 0.0;
+    int n = (x2 - x1) * (y2 - y1);
+    return box_sum(x1, y1, x2, y2) * (1.0 / n);
+}
+
+double IntensityTable::variance(int x1, int y1, int x2, int y2) const
+{
+    if (sqsum.empty() || !clamp(x1, y1, x2, y2)) return 0.0;
+    double n = (double)(x2 - x1) * (y2 - y1);
+    double m = box_sum(x1, y1, x2, y2) / n;
+
+    const double* top = sqsum.ptr<double>(y1);
+    const double* bot = sqsum.ptr<double>(y2);
+    double sq = bot[x2] - bot[x1] - top[x2] + top[x1];
+    return std::max(0.0, sq / n - m * m);
+}
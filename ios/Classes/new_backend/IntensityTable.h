@@ -0,0 +1,52 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+
+// Summed-area table over a grayscale image.
+//
+// Built once per image (one pass, same cost as a single cv::mean over the
+// whole frame); after that the mean and variance of any axis-aligned box
+// are O(1) lookups, so per-spot metrics no longer scale with spot size.
+// Boxes are half-open [x1, x2) x [y1, y2) and clamped to the image, the
+// same convention the old per-spot cv::mean(gray(roi)) used.
+//
+// Min/max are deliberately not offered: they aren't decomposable over a
+// summed-area table, so a "table" for them would just be the ROI scan
+// again.
+class IntensityTable
+{
+public:
+    IntensityTable() = default;
+
+    // gray must be CV_8UC1. withVariance also builds the squared-sum
+    // table (one more CV_64F plane) so variance() is available.
+    explicit IntensityTable(const cv::Mat& gray, bool withVariance = false);
+
+    bool empty() const { return sum.empty(); }
+    int cols() const { return width; }
+    int rows() const { return height; }
+
+    // Memory held by the tables.
+    size_t bytes() const { return sum.total() * sum.elemSize() + sqsum.total() * sqsum.elemSize(); }
+
+    // Pixel count of the clamped box, 0 if it is empty.
+    int count(int x1, int y1, int x2, int y2) const;
+
+    // Mean gray level of the clamped box, 0 if it is empty. Bit-identical
+    // to cv::mean over the same ROI (same integer sum, same 1/n scale)
+    // for any box summing to less than 2^32.
+    double mean(int x1, int y1, int x2, int y2) const;
+
+    // Population variance of the clamped box, 0 if it is empty or the
+    // table was built without withVariance.
+    double variance(int x1, int y1, int x2, int y2) const;
+
+private:
+    bool clamp(int& x1, int& y1, int& x2, int& y2) const;
+    double box_sum(int x1, int y1, int x2, int y2) const;
+
+    cv::Mat sum;   // CV_32S storage of wrapping uint32_t sums (see the constructor)
+    cv::Mat sqsum; // CV_64F, only with withVariance
+    int width = 0;
+    int height = 0;
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdint.h>
+
+// Binary result layout returned by process_tlc_packed and
+// add_manual_spots_packed — the same spots process_tlc's JSON carries,
+// as a struct-of-arrays in one malloc'd block (release with free_result).
+//
+// Everything is native-endian and every offset is in bytes from the start
+// of the buffer. Each array starts on an 8-byte boundary, so Dart can
+// wrap it with Pointer.asTypedList (Int32List, Float64List, Float32List)
+// without copying. Readers check magic and version before anything else
+// and must use headerSize/offsets rather than sizeof(TlcPackedHeader):
+// later versions may only append fields.
+//
+// On failure status is non-zero, count is 0, and the error message is at
+// errorOffset. Strings are UTF-8, NUL-terminated; lengths exclude the NUL.
+
+#define TLC_PACKED_MAGIC   0x52434C54u /* "TLCR" */
+#define TLC_PACKED_VERSION 2
+
+typedef struct TlcPackedHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t headerSize;
+    uint32_t totalSize;        // whole buffer, header included
+    int32_t  status;           // 0 = ok
+    uint32_t count;            // number of spots, sorted by rf ascending
+
+    uint32_t errorOffset;      // char[errorLength + 1]
+    uint32_t errorLength;
+    uint32_t plotPathOffset;   // char[plotPathLength + 1]; empty for add_manual_spots
+    uint32_t plotPathLength;
+
+    uint32_t idOffset;         // int32_t[count]
+    uint32_t laneIdOffset;     // int32_t[count]
+    uint32_t rfOffset;         // double[count]
+    uint32_t intensityOffset;  // double[count]
+    uint32_t aucOffset;        // double[count]
+    uint32_t confidenceOffset; // float[count]
+    uint32_t boxOffset;        // float[count * 4]: x1, y1, x2, y2 per spot, absolute pixels
+
+    // Version 2
+    int64_t  outputHandle;     // tlc_wait_output() handle when the output files
+                               // were queued (options async=1), else 0
+} TlcPackedHeader;
@@ -1,9 +1,22 @@
 #include "SpotDetector.h"
 
+#include <onnxruntime_session_options_config_keys.h>
 #include <opencv2/dnn.hpp>
+#include <opencv2/core/hal/intrin.hpp>
 #include <algorithm>
 #include <iostream>
+#include <sstream>
+#include <stdexcept>
 #include <cmath>
+#include <map>
+#include <mutex>
+#include <fstream>
+#include <cstdio>
+#include <cstdint>
+#include <sys/stat.h>
+#if !defined(_WIN32)
+#include <dirent.h>
+#endif
 
 #ifdef __ANDROID__
 #include <android/log.h>
@@ -26,84 +39,659 @@ static Ort::Env& get_global_env() {
 }
 
 namespace {
-    Ort::SessionOptions make_session_options() {
+#if defined(_WIN32)
+    std::basic_string<ORTCHAR_T> to_ort_path(const std::string& path) {
+        return std::wstring(path.begin(), path.end());
+    }
+#else
+    std::basic_string<ORTCHAR_T> to_ort_path(const std::string& path) {
+        return path;
+    }
+#endif
+
+    Ort::SessionOptions make_session_options(const SessionPolicy& policy) {
         Ort::SessionOptions opts;
-        opts.SetIntraOpNumThreads(1);
+        opts.SetIntraOpNumThreads(policy.intraOpThreads);
+        opts.SetInterOpNumThreads(policy.interOpThreads);
+        opts.SetExecutionMode(policy.parallelExecution ? ExecutionMode::ORT_PARALLEL
+                                                       : ExecutionMode::ORT_SEQUENTIAL);
+        opts.SetGraphOptimizationLevel(policy.optimizationLevel);
+        opts.AddConfigEntry(kOrtSessionOptionsConfigAllowIntraOpSpinning, policy.allowSpinning ? "1" : "0");
+        opts.AddConfigEntry(kOrtSessionOptionsConfigAllowInterOpSpinning, policy.allowSpinning ? "1" : "0");
+        if (!policy.optimizedModelPath.empty()) {
+            opts.SetOptimizedModelFilePath(to_ort_path(policy.optimizedModelPath).c_str());
+        }
         return opts;
     }
 
-#if defined(_WIN32)
-    Ort::Session open_session(const std::string& modelPath) {
-        std::wstring wModelPath(modelPath.begin(), modelPath.end());
-        return Ort::Session(get_global_env(), wModelPath.c_str(), make_session_options());
+    // -------------------------------------------------------------------
+    // Optimized-model cache.
+    // Parsing and optimizing the .onnx graph dominates cold start. With a
+    // cache directory configured, the first load saves the optimized graph
+    // in ORT format into that directory as
+    //   <model stem>.opt<level>-<hash>.ort
+    // where the hash covers the source .onnx bytes, the ORT version and the
+    // optimization level — everything that makes a saved graph invalid.
+    // A stale cache therefore simply misses and is regenerated. Once the
+    // new entry is written, older entries for the same stem *and* level
+    // are deleted, so two policies sharing a model keep one entry each
+    // instead of evicting each other on every load.
+    // -------------------------------------------------------------------
+    bool file_exists(const std::string& path) {
+        struct stat st;
+        return stat(path.c_str(), &st) == 0;
+    }
+
+    // 64-bit FNV-1a over the model file plus the other cache-key inputs.
+    bool hash_model(const std::string& modelPath, const SessionPolicy& policy, uint64_t& out) {
+        std::ifstream in(modelPath, std::ios::binary);
+        if (!in) return false;
+
+        uint64_t h = 1469598103934665603ULL;
+        auto mix = [&h](const char* data, size_t n) {
+            for (size_t i = 0; i < n; ++i) {
+                h ^= static_cast<unsigned char>(data[i]);
+                h *= 1099511628211ULL;
+            }
+        };
+
+        std::vector<char> buf(1 << 16);
+        while (in) {
+            in.read(buf.data(), buf.size());
+            mix(buf.data(), static_cast<size_t>(in.gcount()));
+        }
+
+        std::string salt = Ort::GetVersionString() + "|opt=" + std::to_string(static_cast<int>(policy.optimizationLevel));
+        mix(salt.data(), salt.size());
+        out = h;
+        return true;
+    }
+
+    std::string model_stem(const std::string& modelPath) {
+        size_t slash = modelPath.find_last_of("/\\");
+        std::string name = (slash == std::string::npos) ? modelPath : modelPath.substr(slash + 1);
+        size_t dot = name.rfind('.');
+        return (dot == std::string::npos) ? name : name.substr(0, dot);
+    }
+
+    // True if name is exactly <prefix>-<16 lowercase hex digits>.ort.
+    bool is_cache_entry_name(const std::string& name, const std::string& prefix) {
+        if (name.size() != prefix.size() + 1 + 16 + 4 ||
+            name.compare(0, prefix.size(), prefix) != 0 ||
+            name[prefix.size()] != '-' ||
+            name.compare(name.size() - 4, 4, ".ort") != 0) {
+            return false;
+        }
+        for (size_t i = prefix.size() + 1; i < prefix.size() + 17; ++i) {
+            char c = name[i];
+            if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f'))) return false;
+        }
+        return true;
     }
+
+    // Deletes the superseded entries for one stem + policy (family).
+    // Nothing else in the directory is touched, including other models
+    // whose names merely start with the same stem.
+    void remove_stale_cache_entries(const std::string& cacheDir, const std::string& family,
+                                    const std::string& keepName) {
+#if !defined(_WIN32)
+        DIR* dir = opendir(cacheDir.c_str());
+        if (!dir) return;
+        while (struct dirent* entry = readdir(dir)) {
+            std::string name = entry->d_name;
+            if (name == keepName) continue;
+            if (is_cache_entry_name(name, family)) {
+                std::remove((cacheDir + "/" + name).c_str());
+            }
+        }
+        closedir(dir);
 #else
-    Ort::Session open_session(const std::string& modelPath) {
-        return Ort::Session(get_global_env(), modelPath.c_str(), make_session_options());
+        (void)cacheDir; (void)family; (void)keepName;
+#endif
+    }
+
+    Ort::Session open_cached_session(const std::string& modelPath, const SessionPolicy& policy) {
+        uint64_t hash = 0;
+        if (!hash_model(modelPath, policy, hash)) {
+            // Let the regular load path produce the "file not found" error.
+            return Ort::Session(get_global_env(), to_ort_path(modelPath).c_str(), make_session_options(policy));
+        }
+
+        char hex[17];
+        std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(hash));
+        std::string stem = model_stem(modelPath);
+        std::string family = stem + ".opt" + std::to_string(static_cast<int>(policy.optimizationLevel));
+        std::string cachedName = family + "-" + hex + ".ort";
+        std::string cachedPath = policy.cacheDir + "/" + cachedName;
+
+        SessionPolicy uncached = policy;
+        uncached.optimizedModelPath.clear();
+
+        if (file_exists(cachedPath)) {
+            try {
+                Ort::SessionOptions opts = make_session_options(uncached);
+                opts.AddConfigEntry(kOrtSessionOptionsConfigLoadModelFormat, "ORT");
+                Ort::Session session(get_global_env(), to_ort_path(cachedPath).c_str(), opts);
+                LOGI("Loaded cached ORT model: %s", cachedPath.c_str());
+                return session;
+            } catch (const Ort::Exception& e) {
+                // Truncated or otherwise unreadable — rebuild it below.
+                LOGI("Discarding unreadable ORT cache %s (%s)", cachedPath.c_str(), e.what());
+                std::remove(cachedPath.c_str());
+            }
+        }
+
+        // Written under a temporary name and renamed into place, so a crash
+        // mid-save never leaves a half-written file under the real name.
+        std::string tmpPath = cachedPath + ".tmp";
+        Ort::SessionOptions opts = make_session_options(uncached);
+        opts.SetOptimizedModelFilePath(to_ort_path(tmpPath).c_str());
+        opts.AddConfigEntry(kOrtSessionOptionsConfigSaveModelFormat, "ORT");
+        Ort::Session session(get_global_env(), to_ort_path(modelPath).c_str(), opts);
+
+        if (file_exists(tmpPath) && std::rename(tmpPath.c_str(), cachedPath.c_str()) == 0) {
+            remove_stale_cache_entries(policy.cacheDir, family, cachedName);
+            LOGI("Saved ORT model cache: %s", cachedPath.c_str());
+        } else {
+            std::remove(tmpPath.c_str());
+            LOGI("Could not write ORT model cache under %s", policy.cacheDir.c_str());
+        }
+        return session;
+    }
+
+    Ort::Session open_session(const std::string& modelPath, const SessionPolicy& policy) {
+        if (!policy.cacheDir.empty()) {
+            return open_cached_session(modelPath, policy);
+        }
+        return Ort::Session(get_global_env(), to_ort_path(modelPath).c_str(), make_session_options(policy));
+    }
+
+    int parse_thread_count(const std::string& key, const std::string& value) {
+        int n = std::stoi(value);
+        if (n < 0) {
+            throw std::invalid_argument("session option " + key + " must be >= 0");
+        }
+        return n;
+    }
+}
+
+SessionPolicy SessionPolicy::parse(const std::string& spec)
+{
+    SessionPolicy policy;
+
+    std::istringstream stream(spec);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        size_t eq = item.find('=');
+        if (eq == std::string::npos) continue;
+        std::string key = item.substr(0, eq);
+        std::string value = item.substr(eq + 1);
+
+        if (key == "intra") {
+            policy.intraOpThreads = parse_thread_count(key, value);
+        } else if (key == "inter") {
+            policy.interOpThreads = parse_thread_count(key, value);
+        } else if (key == "mode") {
+            if (value == "parallel") policy.parallelExecution = true;
+            else if (value == "sequential") policy.parallelExecution = false;
+            else throw std::invalid_argument("unknown session mode: " + value);
+        } else if (key == "opt") {
+            if (value == "disable") policy.optimizationLevel = ORT_DISABLE_ALL;
+            else if (value == "basic") policy.optimizationLevel = ORT_ENABLE_BASIC;
+            else if (value == "extended") policy.optimizationLevel = ORT_ENABLE_EXTENDED;
+            else if (value == "all") policy.optimizationLevel = ORT_ENABLE_ALL;
+            else throw std::invalid_argument("unknown optimization level: " + value);
+        } else if (key == "spin") {
+            policy.allowSpinning = (value != "0");
+        } else if (key == "optimized") {
+            policy.optimizedModelPath = value;
+        } else if (key == "cache") {
+            policy.cacheDir = value;
+        }
+    }
+    return policy;
+}
+
+std::string SessionPolicy::key() const
+{
+    std::ostringstream k;
+    k << "intra=" << intraOpThreads
+      << ",inter=" << interOpThreads
+      << ",mode=" << (parallelExecution ? "parallel" : "sequential")
+      << ",opt=" << static_cast<int>(optimizationLevel)
+      << ",spin=" << (allowSpinning ? 1 : 0)
+      << ",optimized=" << optimizedModelPath
+      << ",cache=" << cacheDir;
+    return k.str();
+}
+
+// -----------------------------------------------------------------------
+// YOLOv8 letterbox preprocessing.
+// The model wants a 1x3x640x640 planar RGB float tensor in [0, 1], with
+// the image aspect-fit into the middle and the rest padded with grey
+// (114). Rather than materialising that as resize → copyMakeBorder →
+// cvtColor → convertTo → per-pixel copy (four full-frame temporaries),
+// the only intermediate kept is the resized BGR image; the channel swap,
+// 1/255 scaling and padding fill all happen in one pass that writes the
+// planar tensor directly. Output is bit-identical to the old chain:
+// convertTo(CV_32F, 1/255) computes float(v) * float(1/255) per element,
+// which is exactly what the kernel below does.
+// -----------------------------------------------------------------------
+namespace {
+    constexpr int kInputSize = 640;
+    constexpr int kPlaneSize = kInputSize * kInputSize;
+
+    struct Letterbox {
+        float r;
+        int unpad_w, unpad_h;
+        int top, bottom, left, right;
+    };
+
+    Letterbox compute_letterbox(int orig_w, int orig_h) {
+        Letterbox lb;
+        lb.r = std::min((float)kInputSize / orig_w, (float)kInputSize / orig_h);
+        lb.unpad_w = (int)std::round(orig_w * lb.r);
+        lb.unpad_h = (int)std::round(orig_h * lb.r);
+
+        float dw = (float)(kInputSize - lb.unpad_w) / 2.0f;
+        float dh = (float)(kInputSize - lb.unpad_h) / 2.0f;
+
+        lb.top    = (int)std::round(dh - 0.1f);
+        lb.bottom = (int)std::round(dh + 0.1f);
+        lb.left   = (int)std::round(dw - 0.1f);
+        lb.right  = (int)std::round(dw + 0.1f);
+        return lb;
+    }
+
+    // Per-thread scratch, reused across detect() calls so steady-state
+    // inference does no per-frame allocation for preprocessing. Thread-local
+    // rather than a member because the same cached SpotDetector can be
+    // used from several threads at once. `input` only ever holds one
+    // image's planes; detect_batch() allocates its tensor per call, so a
+    // worker thread doesn't keep a full batch (~80 MB) alive forever.
+    struct PreprocessScratch {
+        cv::Mat bgr;
+        cv::Mat resized;
+        std::vector<float> input;
+    };
+
+    PreprocessScratch& thread_scratch() {
+        thread_local PreprocessScratch scratch;
+        return scratch;
+    }
+
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+    inline void store_scaled(const cv::v_uint8& v, float* dst, const cv::v_float32& vscale) {
+        const int nf = cv::VTraits<cv::v_float32>::vlanes();
+        cv::v_uint16 w0, w1;
+        cv::v_expand(v, w0, w1);
+        cv::v_uint32 d0, d1, d2, d3;
+        cv::v_expand(w0, d0, d1);
+        cv::v_expand(w1, d2, d3);
+        cv::v_store(dst,          cv::v_mul(cv::v_cvt_f32(cv::v_reinterpret_as_s32(d0)), vscale));
+        cv::v_store(dst + nf,     cv::v_mul(cv::v_cvt_f32(cv::v_reinterpret_as_s32(d1)), vscale));
+        cv::v_store(dst + nf * 2, cv::v_mul(cv::v_cvt_f32(cv::v_reinterpret_as_s32(d2)), vscale));
+        cv::v_store(dst + nf * 3, cv::v_mul(cv::v_cvt_f32(cv::v_reinterpret_as_s32(d3)), vscale));
     }
 #endif
+
+    // Converts one row of interleaved BGR8 into three planar float rows
+    // (R, G, B order), scaled by 1/255.
+    void bgr_row_to_planar(const uchar* src, int width, float* dst_r, float* dst_g, float* dst_b, float scale) {
+        int x = 0;
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+        const int step = cv::VTraits<cv::v_uint8>::vlanes();
+        const cv::v_float32 vscale = cv::vx_setall_f32(scale);
+        for (; x <= width - step; x += step) {
+            cv::v_uint8 b, g, r;
+            cv::v_load_deinterleave(src + x * 3, b, g, r);
+            store_scaled(r, dst_r + x, vscale);
+            store_scaled(g, dst_g + x, vscale);
+            store_scaled(b, dst_b + x, vscale);
+        }
+#endif
+        for (; x < width; ++x) {
+            dst_b[x] = (float)src[x * 3 + 0] * scale;
+            dst_g[x] = (float)src[x * 3 + 1] * scale;
+            dst_r[x] = (float)src[x * 3 + 2] * scale;
+        }
+    }
+
+    // Letterboxes `image` (8-bit BGR) into one 3x640x640 planar plane set
+    // starting at `dst`. `resized` is caller-owned scratch.
+    void letterbox_to_planar(const cv::Mat& image, const Letterbox& lb, cv::Mat& resized, float* dst) {
+        const float scale = (float)(1.0 / 255.0);
+        const float pad = 114.0f * scale;
+
+        const cv::Mat* src = &image;
+        if (lb.unpad_w != image.cols || lb.unpad_h != image.rows) {
+            cv::resize(image, resized, cv::Size(lb.unpad_w, lb.unpad_h));
+            src = &resized;
+        }
+
+        float* plane_r = dst;
+        float* plane_g = dst + kPlaneSize;
+        float* plane_b = dst + kPlaneSize * 2;
+
+        for (int y = 0; y < kInputSize; ++y) {
+            float* row_r = plane_r + y * kInputSize;
+            float* row_g = plane_g + y * kInputSize;
+            float* row_b = plane_b + y * kInputSize;
+
+            int sy = y - lb.top;
+            if (sy < 0 || sy >= lb.unpad_h) {
+                std::fill(row_r, row_r + kInputSize, pad);
+                std::fill(row_g, row_g + kInputSize, pad);
+                std::fill(row_b, row_b + kInputSize, pad);
+                continue;
+            }
+
+            std::fill(row_r, row_r + lb.left, pad);
+            std::fill(row_g, row_g + lb.left, pad);
+            std::fill(row_b, row_b + lb.left, pad);
+
+            bgr_row_to_planar(src->ptr<uchar>(sy), lb.unpad_w,
+                              row_r + lb.left, row_g + lb.left, row_b + lb.left, scale);
+
+            int tail = lb.left + lb.unpad_w;
+            std::fill(row_r + tail, row_r + kInputSize, pad);
+            std::fill(row_g + tail, row_g + kInputSize, pad);
+            std::fill(row_b + tail, row_b + kInputSize, pad);
+        }
+    }
+
+    // The kernel above assumes 8-bit 3-channel BGR; anything else (grey or
+    // BGRA input) is normalised first.
+    const cv::Mat& as_bgr8(const cv::Mat& image, cv::Mat& scratch) {
+        if (image.type() == CV_8UC3) return image;
+        if (image.channels() == 1) {
+            cv::cvtColor(image, scratch, cv::COLOR_GRAY2BGR);
+        } else if (image.channels() == 4) {
+            cv::cvtColor(image, scratch, cv::COLOR_BGRA2BGR);
+        } else {
+            image.copyTo(scratch);
+        }
+        if (scratch.depth() != CV_8U) {
+            scratch.convertTo(scratch, CV_8U);
+        }
+        return scratch;
+    }
 }
 
-SpotDetector::SpotDetector(const std::string& modelPath)
-    : session(open_session(modelPath))
+// -----------------------------------------------------------------------
+// YOLOv8 output decoding.
+// The output tensor is [1, 4 + nc, num_anchors], channel-major, so reading
+// one anchor's channels is a strided walk across the whole tensor. Only
+// class 0 is ever kept, so instead of an argmax over every class for
+// every anchor, the class-0 row is scanned contiguously (vectorised) and
+// anything below threshold is rejected before its box or other class
+// scores are touched. Survivors then get the exact same "is class 0 the
+// argmax" test and box decoding as the original per-anchor loop, so the
+// kept set and its order are unchanged.
+// -----------------------------------------------------------------------
+namespace {
+    struct DecodedBoxes {
+        std::vector<cv::Rect> bboxes;
+        std::vector<float> confidences;
+        std::vector<int> classIds;
+    };
+
+    // Appends to `candidates` the index of every anchor whose class-0
+    // score can pass confThreshold.
+    void scan_class0(const float* scores, int num_anchors, float confThreshold, std::vector<int>& candidates) {
+        int i = 0;
+#if (CV_SIMD || CV_SIMD_SCALABLE)
+        const int nf = cv::VTraits<cv::v_float32>::vlanes();
+        const cv::v_float32 vthr = cv::vx_setall_f32(confThreshold);
+        for (; i <= num_anchors - nf; i += nf) {
+            cv::v_float32 pass = cv::v_ge(cv::vx_load(scores + i), vthr);
+            if (!cv::v_check_any(pass)) continue;
+            for (int k = 0; k < nf; ++k) {
+                if (scores[i + k] >= confThreshold) candidates.push_back(i + k);
+            }
+        }
+#endif
+        for (; i < num_anchors; ++i) {
+            if (scores[i] >= confThreshold) candidates.push_back(i);
+        }
+    }
+
+    // Keeps the maxCandidates highest-scoring anchors (ties broken by
+    // anchor index), then restores ascending anchor order so NMS sees the
+    // same relative ordering it would have without the cap.
+    void cap_candidates(std::vector<int>& kept, std::vector<float>& scores, size_t maxCandidates) {
+        if (maxCandidates == 0 || kept.size() <= maxCandidates) return;
+
+        std::vector<size_t> order(kept.size());
+        for (size_t k = 0; k < order.size(); ++k) order[k] = k;
+        std::nth_element(order.begin(), order.begin() + maxCandidates, order.end(),
+                         [&](size_t a, size_t b) {
+                             if (scores[a] != scores[b]) return scores[a] > scores[b];
+                             return kept[a] < kept[b];
+                         });
+        order.resize(maxCandidates);
+        std::sort(order.begin(), order.end());
+
+        std::vector<int> capped_kept(maxCandidates);
+        std::vector<float> capped_scores(maxCandidates);
+        for (size_t k = 0; k < maxCandidates; ++k) {
+            capped_kept[k] = kept[order[k]];
+            capped_scores[k] = scores[order[k]];
+        }
+        kept.swap(capped_kept);
+        scores.swap(capped_scores);
+    }
+
+    DecodedBoxes decode_class0(const float* output, int num_channels, int num_anchors,
+                               const Letterbox& lb, int orig_w, int orig_h,
+                               float confThreshold, size_t maxCandidates) {
+        DecodedBoxes out;
+        if (num_channels < 5 || num_anchors <= 0) return out;
+
+        // max_score starts at 0 in the argmax, so with a non-positive
+        // threshold every anchor qualifies and the pre-scan can't reject.
+        std::vector<int> candidates;
+        if (confThreshold > 0.0f) {
+            candidates.reserve(256);
+            scan_class0(output + 4 * num_anchors, num_anchors, confThreshold, candidates);
+        } else {
+            candidates.resize(num_anchors);
+            for (int i = 0; i < num_anchors; ++i) candidates[i] = i;
+        }
+
+        // Class 0 must also be the argmax: any later class scoring strictly
+        // higher would have taken over in the original loop.
+        std::vector<int> kept;
+        std::vector<float> scores;
+        kept.reserve(candidates.size());
+        scores.reserve(candidates.size());
+        for (int i : candidates) {
+            float max_score = std::max(0.0f, output[4 * num_anchors + i]);
+            bool is_class0 = true;
+            for (int c = 5; c < num_channels; ++c) {
+                if (output[c * num_anchors + i] > max_score) {
+                    is_class0 = false;
+                    break;
+                }
+            }
+            if (is_class0 && max_score >= confThreshold) {
+                kept.push_back(i);
+                scores.push_back(max_score);
+            }
+        }
+
+        cap_candidates(kept, scores, maxCandidates);
+
+        out.bboxes.reserve(kept.size());
+        out.confidences.reserve(kept.size());
+        out.classIds.reserve(kept.size());
+
+        for (size_t k = 0; k < kept.size(); ++k) {
+            int i = kept[k];
+            float cx = output[0 * num_anchors + i];
+            float cy = output[1 * num_anchors + i];
+            float w  = output[2 * num_anchors + i];
+            float h  = output[3 * num_anchors + i];
+
+            // Scale back coordinates: subtract padding and divide by ratio
+            float cx_orig = (cx - lb.left) / lb.r;
+            float cy_orig = (cy - lb.top) / lb.r;
+            float w_orig  = w / lb.r;
+            float h_orig  = h / lb.r;
+
+            float x1 = cx_orig - w_orig / 2.0f;
+            float y1 = cy_orig - h_orig / 2.0f;
+
+            int ix1 = std::max(0, std::min((int)x1, orig_w - 1));
+            int iy1 = std::max(0, std::min((int)y1, orig_h - 1));
+            int iw  = std::max(1, std::min((int)w_orig, orig_w - ix1));
+            int ih  = std::max(1, std::min((int)h_orig, orig_h - iy1));
+
+            out.bboxes.push_back(cv::Rect(ix1, iy1, iw, ih));
+            out.confidences.push_back(scores[k]);
+            out.classIds.push_back(0);
+        }
+        return out;
+    }
+}
+
+SpotDetector::SpotDetector(const std::string& modelPath, const SessionPolicy& policy)
+    : session(open_session(modelPath, policy)), batchDynamic(false)
 {
+    // Exported YOLOv8 models either have a symbolic batch dimension
+    // (reported as -1) or a fixed one of 1. Only the former can take
+    // several lane crops in one Run().
+    std::vector<int64_t> inShape = session.GetInputTypeInfo(0).GetTensorTypeAndShapeInfo().GetShape();
+    batchDynamic = !inShape.empty() && inShape[0] < 0;
+}
+
+// -----------------------------------------------------------------------
+// Process-lifetime session registry. Entries are keyed by model path plus
+// SessionPolicy::key() and revalidated against the file's mtime on every acquire(), so replacing a
+// model on disk (e.g. an app update shipping new weights) is picked up
+// without a restart. Loading happens under the registry lock — two calls
+// racing to load the same model would otherwise both pay the full
+// graph-optimization cost.
+// -----------------------------------------------------------------------
+namespace {
+    struct CachedSession {
+        long long mtime;
+        std::shared_ptr<SpotDetector> detector;
+    };
+
+    std::mutex& registry_mutex() {
+        static std::mutex m;
+        return m;
+    }
+
+    std::map<std::string, CachedSession>& registry() {
+        static std::map<std::string, CachedSession> sessions;
+        return sessions;
+    }
+
+    long long file_mtime(const std::string& path) {
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0) return -1;
+        return static_cast<long long>(st.st_mtime);
+    }
 }
 
-std::vector<Spot> SpotDetector::detect(const cv::Mat& image, float confThreshold, float iouThreshold)
+std::shared_ptr<SpotDetector> SpotDetector::acquire(const std::string& modelPath, const SessionPolicy& policy)
 {
-    std::vector<Spot> detections;
+    long long mtime = file_mtime(modelPath);
+    std::string key = modelPath + "|" + policy.key();
 
-    if (image.empty())
-    {
-        std::cerr << "Error: Input image is empty" << std::endl;
-        return detections;
+    std::lock_guard<std::mutex> lock(registry_mutex());
+    auto& sessions = registry();
+
+    auto it = sessions.find(key);
+    if (it != sessions.end() && it->second.mtime == mtime) {
+        return it->second.detector;
     }
 
-    int orig_w = image.cols;
-    int orig_h = image.rows;
+    LOGI("Loading ONNX session: %s (%s)", modelPath.c_str(), policy.key().c_str());
+    auto detector = std::make_shared<SpotDetector>(modelPath, policy);
+    sessions[key] = CachedSession{ mtime, detector };
+    return detector;
+}
 
-    // 1. YOLOv8 Letterbox Preprocessing
-    float r = std::min(640.0f / orig_w, 640.0f / orig_h);
-    int unpad_w = (int)std::round(orig_w * r);
-    int unpad_h = (int)std::round(orig_h * r);
+void SpotDetector::release_all()
+{
+    std::lock_guard<std::mutex> lock(registry_mutex());
+    registry().clear();
+}
 
-    int pad_w = 640 - unpad_w;
-    int pad_h = 640 - unpad_h;
+namespace {
+    // Upper bound on crops per Run(): 16 covers the largest plates we see
+    // in one inference while keeping the input tensor under ~80 MB.
+    constexpr size_t kMaxBatchSize = 16;
 
-    float dw = (float)pad_w / 2.0f;
-    float dh = (float)pad_h / 2.0f;
+    // Decode + NMS for one image's slice of the output tensor.
+    std::vector<Spot> postprocess(const float* output, int num_channels, int num_anchors,
+                                  const Letterbox& lb, int orig_w, int orig_h,
+                                  float confThreshold, float iouThreshold, size_t maxCandidates) {
+        std::vector<Spot> detections;
 
-    int top = (int)std::round(dh - 0.1f);
-    int bottom = (int)std::round(dh + 0.1f);
-    int left = (int)std::round(dw - 0.1f);
-    int right = (int)std::round(dw + 0.1f);
+        // Restricted to class 0 to match existing production behaviour
+        // (both the spot model and the single-class strip model only ever
+        // care about class 0).
+        DecodedBoxes decoded = decode_class0(output, num_channels, num_anchors, lb,
+                                             orig_w, orig_h, confThreshold, maxCandidates);
+        std::vector<cv::Rect>& bboxes = decoded.bboxes;
+        std::vector<float>& confidences = decoded.confidences;
+        std::vector<int>& classIds = decoded.classIds;
 
-    cv::Mat resized;
-    cv::resize(image, resized, cv::Size(unpad_w, unpad_h));
-    cv::copyMakeBorder(resized, resized, top, bottom, left, right, cv::BORDER_CONSTANT, cv::Scalar(114, 114, 114));
+        LOGI("Raw boxes passing threshold (%.4f): %d", confThreshold, static_cast<int>(bboxes.size()));
+
+        std::vector<int> indices;
+        if (!bboxes.empty()) {
+            cv::dnn::NMSBoxes(bboxes, confidences, confThreshold, iouThreshold, indices);
+        }
+
+        LOGI("Boxes after NMS: %d", static_cast<int>(indices.size()));
+
+        detections.reserve(indices.size());
+
+        for (int idx : indices)
+        {
+            Spot s;
+            s.x1 = (float)bboxes[idx].x;
+            s.y1 = (float)bboxes[idx].y;
+            s.x2 = (float)(bboxes[idx].x + bboxes[idx].width);
+            s.y2 = (float)(bboxes[idx].y + bboxes[idx].height);
+            s.confidence = confidences[idx];
+            s.cls = classIds[idx];
+            detections.push_back(s);
+        }
 
-    // Verify letterboxed image is exactly 640x640
-    if (resized.cols != 640 || resized.rows != 640) {
-        std::cerr << "Error: Letterbox result is " << resized.cols << "x" << resized.rows << ", expected 640x640" << std::endl;
         return detections;
     }
 
-    cv::cvtColor(resized, resized, cv::COLOR_BGR2RGB);
-    resized.convertTo(resized, CV_32F, 1.0 / 255.0);
-
-    std::vector<float> inputTensorValues(3 * 640 * 640);
-    for (int c = 0; c < 3; c++)
-    {
-        for (int y = 0; y < 640; y++)
+    // Letterboxes one image, or returns false (after logging why) if it
+    // can't be fed to the model.
+    bool prepare_letterbox(const cv::Mat& image, Letterbox& lb) {
+        if (image.empty())
         {
-            for (int x = 0; x < 640; x++)
-            {
-                inputTensorValues[c * 640 * 640 + y * 640 + x] = resized.at<cv::Vec3f>(y, x)[c];
-            }
+            std::cerr << "Error: Input image is empty" << std::endl;
+            return false;
+        }
+
+        lb = compute_letterbox(image.cols, image.rows);
+
+        // Verify letterboxed image is exactly 640x640
+        int boxed_w = lb.left + lb.unpad_w + lb.right;
+        int boxed_h = lb.top + lb.unpad_h + lb.bottom;
+        if (boxed_w != kInputSize || boxed_h != kInputSize) {
+            std::cerr << "Error: Letterbox result is " << boxed_w << "x" << boxed_h << ", expected 640x640" << std::endl;
+            return false;
         }
+        return true;
     }
+}
 
-    std::vector<int64_t> inputShape = { 1, 3, 640, 640 };
+std::vector<Ort::Value> SpotDetector::run(std::vector<float>& input, int64_t batch)
+{
+    std::vector<int64_t> inputShape = { batch, 3, kInputSize, kInputSize };
 
     // Non-arena device allocator, deliberately not OrtArenaAllocator — the
     // arena allocator is what the Android ARM64 MTE corruption (see the Env
@@ -116,8 +704,8 @@ std::vector<Spot> SpotDetector::detect(const cv::Mat& image, float confThreshold
 
     Ort::Value inputTensor = Ort::Value::CreateTensor<float>(
             memoryInfo,
-            inputTensorValues.data(),
-            inputTensorValues.size(),
+            input.data(),
+            input.size(),
             inputShape.data(),
             inputShape.size()
     );
@@ -125,7 +713,7 @@ std::vector<Spot> SpotDetector::detect(const cv::Mat& image, float confThreshold
     const char* inputNames[] = { "images" };
     const char* outputNames[] = { "output0" };
 
-    auto outputTensors = session.Run(
+    return session.Run(
             Ort::RunOptions{ nullptr },
             inputNames,
             &inputTensor,
@@ -133,8 +721,24 @@ std::vector<Spot> SpotDetector::detect(const cv::Mat& image, float confThreshold
             outputNames,
             1
     );
+}
+
+std::vector<Spot> SpotDetector::detect(const cv::Mat& image, float confThreshold, float iouThreshold, size_t maxCandidates)
+{
+    // 1. YOLOv8 Letterbox Preprocessing (fused; see letterbox_to_planar)
+    Letterbox lb;
+    if (!prepare_letterbox(image, lb)) {
+        return std::vector<Spot>();
+    }
 
-    float* output = outputTensors[0].GetTensorMutableData<float>();
+    PreprocessScratch& scratch = thread_scratch();
+    std::vector<float>& inputTensorValues = scratch.input;
+    inputTensorValues.resize(3 * kPlaneSize);
+    letterbox_to_planar(as_bgr8(image, scratch.bgr), lb, scratch.resized, inputTensorValues.data());
+
+    auto outputTensors = run(inputTensorValues, 1);
+
+    const float* output = outputTensors[0].GetTensorData<float>();
 
     // Dynamically retrieve output tensor shape to handle arbitrary class
     // counts (nc) — the spot model and the strip/lane model have different
@@ -148,84 +752,67 @@ std::vector<Spot> SpotDetector::detect(const cv::Mat& image, float confThreshold
 
     LOGI("ONNX output shape: %d x %d x %d", static_cast<int>(outShape[0]), num_channels, num_anchors);
 
-    std::vector<cv::Rect> bboxes;
-    std::vector<float> confidences;
-    std::vector<int> classIds;
-
-    // Pre-reserve to avoid repeated reallocations
-    bboxes.reserve(64);
-    confidences.reserve(64);
-    classIds.reserve(64);
-
-    for (int i = 0; i < num_anchors; ++i)
-    {
-        float cx = output[0 * num_anchors + i];
-        float cy = output[1 * num_anchors + i];
-        float w  = output[2 * num_anchors + i];
-        float h  = output[3 * num_anchors + i];
-
-        float max_score = 0.0f;
-        int class_id = 0;
-        for (int c = 4; c < num_channels; ++c)
-        {
-            float score = output[c * num_anchors + i];
-            if (score > max_score)
-            {
-                max_score = score;
-                class_id = c - 4;
-            }
-        }
-
-        // Restricted to class 0 to match existing production behaviour
-        // (both the spot model and the single-class strip model only ever
-        // care about class 0).
-        if (class_id == 0 && max_score >= confThreshold)
-        {
-            // Scale back coordinates: subtract padding and divide by ratio
-            float cx_orig = (cx - left) / r;
-            float cy_orig = (cy - top) / r;
-            float w_orig  = w / r;
-            float h_orig  = h / r;
+    return postprocess(output, num_channels, num_anchors, lb, image.cols, image.rows,
+                       confThreshold, iouThreshold, maxCandidates);
+}
 
-            float x1 = cx_orig - w_orig / 2.0f;
-            float y1 = cy_orig - h_orig / 2.0f;
+std::vector<std::vector<Spot>> SpotDetector::detect_batch(const std::vector<cv::Mat>& images, float confThreshold,
+                                                          float iouThreshold, size_t maxCandidates)
+{
+    std::vector<std::vector<Spot>> results(images.size());
 
-            int ix1 = std::max(0, std::min((int)x1, orig_w - 1));
-            int iy1 = std::max(0, std::min((int)y1, orig_h - 1));
-            int iw  = std::max(1, std::min((int)w_orig, orig_w - ix1));
-            int ih  = std::max(1, std::min((int)h_orig, orig_h - iy1));
+    // Fixed batch-1 export (or nothing worth batching): one Run per image.
+    if (!batchDynamic || images.size() < 2) {
+        for (size_t i = 0; i < images.size(); ++i) {
+            results[i] = detect(images[i], confThreshold, iouThreshold, maxCandidates);
+        }
+        return results;
+    }
 
-            bboxes.push_back(cv::Rect(ix1, iy1, iw, ih));
-            confidences.push_back(max_score);
-            classIds.push_back(class_id);
+    std::vector<size_t> valid;
+    std::vector<Letterbox> boxes;
+    valid.reserve(images.size());
+    boxes.reserve(images.size());
+    for (size_t i = 0; i < images.size(); ++i) {
+        Letterbox lb;
+        if (prepare_letterbox(images[i], lb)) {
+            valid.push_back(i);
+            boxes.push_back(lb);
         }
     }
 
-    LOGI("Raw boxes passing threshold (%.4f): %d", confThreshold, static_cast<int>(bboxes.size()));
+    PreprocessScratch& scratch = thread_scratch();
+    std::vector<float> inputTensorValues;
 
-    // Release ONNX output tensors before NMS to free their memory
-    outputTensors.clear();
+    for (size_t start = 0; start < valid.size(); start += kMaxBatchSize) {
+        size_t count = std::min(kMaxBatchSize, valid.size() - start);
 
-    std::vector<int> indices;
-    if (!bboxes.empty()) {
-        cv::dnn::NMSBoxes(bboxes, confidences, confThreshold, iouThreshold, indices);
-    }
+        inputTensorValues.resize(count * 3 * kPlaneSize);
+        for (size_t k = 0; k < count; ++k) {
+            const cv::Mat& image = images[valid[start + k]];
+            letterbox_to_planar(as_bgr8(image, scratch.bgr), boxes[start + k], scratch.resized,
+                                inputTensorValues.data() + k * 3 * kPlaneSize);
+        }
+
+        auto outputTensors = run(inputTensorValues, static_cast<int64_t>(count));
 
-    LOGI("Boxes after NMS: %d", static_cast<int>(indices.size()));
+        const float* output = outputTensors[0].GetTensorData<float>();
+        std::vector<int64_t> outShape = outputTensors[0].GetTensorTypeAndShapeInfo().GetShape();
 
-    detections.reserve(indices.size());
+        // YOLOv8 output is [batch, num_channels, num_anchors]
+        int num_channels = static_cast<int>(outShape[1]);
+        int num_anchors = static_cast<int>(outShape[2]);
+        size_t image_stride = static_cast<size_t>(num_channels) * num_anchors;
 
-    for (int idx : indices)
-    {
-        Spot s;
-        s.x1 = (float)bboxes[idx].x;
-        s.y1 = (float)bboxes[idx].y;
-        s.x2 = (float)(bboxes[idx].x + bboxes[idx].width);
-        s.y2 = (float)(bboxes[idx].y + bboxes[idx].height);
-        s.confidence = confidences[idx];
-        s.cls = classIds[idx];
-        detections.push_back(s);
+        LOGI("ONNX batched output shape: %d x %d x %d", static_cast<int>(outShape[0]), num_channels, num_anchors);
+
+        for (size_t k = 0; k < count; ++k) {
+            size_t idx = valid[start + k];
+            results[idx] = postprocess(output + k * image_stride, num_channels, num_anchors, boxes[start + k],
+                                       images[idx].cols, images[idx].rows,
+                                       confThreshold, iouThreshold, maxCandidates);
+        }
     }
 
-    return detections;
+    return results;
 }
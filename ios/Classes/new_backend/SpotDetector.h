@@ -2,6 +2,7 @@
 
 #include <vector>
 #include <string>
+#include <memory>
 #include <onnxruntime_cxx_api.h>
 #include <opencv2/opencv.hpp>
 
@@ -15,6 +16,35 @@ struct Spot
     int cls;
 };
 
+// ONNX Runtime session tuning. The defaults reproduce the historical
+// mobile configuration (a single intra-op thread, everything else left at
+// ORT's defaults); server deployments typically raise the thread counts.
+struct SessionPolicy
+{
+    int intraOpThreads = 1;        // 0 = let ORT choose (one per core)
+    int interOpThreads = 0;        // only meaningful with parallelExecution
+    bool parallelExecution = false;
+    GraphOptimizationLevel optimizationLevel = ORT_ENABLE_ALL;
+    bool allowSpinning = true;     // false trades latency for idle CPU
+    std::string optimizedModelPath; // if set, ORT saves the optimized graph here
+                                    // (spot model only — callers clear it for
+                                    // the strip model so the two don't collide)
+    std::string cacheDir;          // if set, optimized ORT-format models are
+                                   // cached here (see SpotDetector.cpp);
+                                   // takes precedence over optimizedModelPath
+
+    // Parses a comma-separated key=value list, e.g.
+    //   "intra=4,inter=2,mode=parallel,opt=extended,spin=0,optimized=/tmp/m.onnx,cache=/data/ort"
+    // opt is one of disable|basic|extended|all; mode is sequential|parallel.
+    // Unknown keys are ignored so the same string can carry options meant
+    // for other layers; malformed values throw std::invalid_argument.
+    static SessionPolicy parse(const std::string& spec);
+
+    // Canonical string form — two policies with the same key() produce
+    // identically configured sessions.
+    std::string key() const;
+};
+
 // Runs YOLOv8 ONNX detection against an already-loaded image (or lane crop).
 // Used for both the spot model and the lane/strip model — construct one
 // instance per model.
@@ -24,10 +54,12 @@ struct Spot
 // SpotDetector.cpp). ONNX Runtime requires exactly one Env per process;
 // creating/destroying multiple Envs corrupts the arena allocator on Android
 // ARM64 (MTE-enabled devices), causing SIGSEGV in subsequent std::vector
-// reallocations. A SpotDetector instance is safe to construct fresh within
-// a single top-level call (e.g. once per lane, or once for the whole call)
-// and call detect() on multiple times — just don't cache one as a
-// long-lived singleton across separate top-level FFI calls.
+// reallocations. Sessions themselves are fine to keep alive as long as that
+// Env is never torn down, so the FFI layer doesn't construct detectors
+// directly any more — it goes through acquire(), which hands out a shared
+// instance from a process-lifetime registry (keyed by model path + file
+// mtime) so the ONNX graph is parsed and optimized once per model rather
+// than once per plate.
 class SpotDetector
 {
 public:
@@ -35,9 +67,42 @@ public:
     // string distinction ONNX Runtime requires is handled internally in
     // the .cpp, so callers never need to deal with wstring conversion or
     // #ifdefs themselves.
-    explicit SpotDetector(const std::string& modelPath);
-    std::vector<Spot> detect(const cv::Mat& image, float confThreshold = 0.0009f, float iouThreshold = 0.45f);
+    explicit SpotDetector(const std::string& modelPath, const SessionPolicy& policy = SessionPolicy());
+    // maxCandidates, when non-zero, caps how many above-threshold boxes are
+    // handed to NMS (highest scores win). With the spot model's very low
+    // threshold nearly every anchor survives decoding, and NMS cost grows
+    // quadratically in that count. 0 = no cap (the historical behaviour).
+    std::vector<Spot> detect(const cv::Mat& image, float confThreshold = 0.0009f, float iouThreshold = 0.45f,
+                             size_t maxCandidates = 0);
+
+    // Runs detection on several images (e.g. every lane crop of a plate)
+    // in a single ORT Run when the model was exported with a dynamic batch
+    // dimension; results[i] corresponds to images[i]. Models with a fixed
+    // batch of 1 transparently fall back to one detect() per image, so
+    // callers don't need to know which kind of export they were given.
+    std::vector<std::vector<Spot>> detect_batch(const std::vector<cv::Mat>& images, float confThreshold = 0.0009f,
+                                                float iouThreshold = 0.45f, size_t maxCandidates = 0);
+
+    // True when detect_batch() can actually batch (dynamic batch dimension).
+    bool supports_batch() const { return batchDynamic; }
+
+    // Returns the cached detector for modelPath + policy, loading it on
+    // first use (or again if the file's mtime changed since it was cached).
+    // The same model under two different policies is two sessions. Throws
+    // whatever the Ort::Session constructor throws if the model can't be
+    // loaded. Callers keep the shared_ptr only for the duration of one
+    // top-level call; release_all() can then drop the registry's references
+    // without pulling a session out from under an in-flight detect().
+    static std::shared_ptr<SpotDetector> acquire(const std::string& modelPath,
+                                                 const SessionPolicy& policy = SessionPolicy());
+
+    // Drops every cached session. Instances still held by callers stay
+    // valid until their last shared_ptr goes away.
+    static void release_all();
 
 private:
+    std::vector<Ort::Value> run(std::vector<float>& input, int64_t batch);
+
     Ort::Session session;
+    bool batchDynamic;
 };
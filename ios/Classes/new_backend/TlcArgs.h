@@ -0,0 +1,91 @@
+#pragma once
+
+#include <stdint.h>
+#include "../image_buffer.hpp"
+
+// Structured argument ABI for the TLC entry points (process_tlc_args,
+// add_manual_spots_args and their _packed variants in ffi_exports.cpp).
+//
+// Same inputs as the pipe-delimited strings, passed as plain C structs so
+// nothing has to be formatted by the caller or re-parsed here: numbers
+// stay numbers and spot lists are pointer + count arrays, read in place.
+// Every struct starts with structSize (set it to sizeof the struct) so
+// fields can be appended later without breaking older callers.
+//
+// String fields are UTF-8, NUL-terminated; NULL means "not given".
+
+// Opaque handle to a loaded model session (see tlc_open_model). Sessions
+// are shared with the process-wide model registry, so opening the same
+// path + options twice is cheap.
+typedef struct TlcModel TlcModel;
+
+// Axis-aligned box in absolute image-pixel coordinates.
+typedef struct TlcBox {
+    float x1;
+    float y1;
+    float x2;
+    float y2;
+} TlcBox;
+
+// A spot already returned by an earlier call, passed back as-is
+// (add_manual_spots redraws these without recomputing anything).
+typedef struct TlcSpotRecord {
+    TlcBox  box;
+    double  rf;
+    double  intensity;
+    double  auc;
+    float   confidence;
+    int32_t laneId;
+} TlcSpotRecord;
+
+typedef struct TlcProcessArgs {
+    uint32_t structSize;
+
+    const char* imagePath;
+    const char* outputImagePath; // annotated image; NULL = overwrite imagePath
+    const char* plotOutputPath;  // densitogram; NULL = don't render one
+
+    // Models: a handle wins over a path. With neither, the strip model is
+    // skipped (whole image = one lane); the spot model is required.
+    TlcModel*   spotModel;
+    const char* spotModelPath;
+    TlcModel*   stripModel;
+    const char* stripModelPath;
+    const char* options;         // same key=value list as process_tlc's
+
+    double baseline;
+    double topline;
+
+    const TlcBox* manualSpots;
+    uint32_t      manualSpotCount;
+
+    // Appended in the raw-buffer revision. When image is set it is used
+    // instead of imagePath; when outputImage is set the annotated image is
+    // written there instead of to a file (see image_buffer.hpp for the
+    // too-small case). Callers built against the older struct simply pass
+    // a smaller structSize and get the file behaviour.
+    const ImageBuffer* image;
+    ImageBuffer*       outputImage;
+} TlcProcessArgs;
+
+typedef struct TlcAddSpotsArgs {
+    uint32_t structSize;
+
+    const char* originalImagePath;
+    const char* outputImagePath; // required unless outputImage is set:
+                                 // the original must stay clean for the
+                                 // next call
+
+    double baseline;
+    double topline;
+
+    const TlcSpotRecord* existingSpots;
+    uint32_t             existingSpotCount;
+    const TlcBox*        newBoxes;
+    uint32_t             newBoxCount;
+
+    // Raw-buffer revision, as in TlcProcessArgs. With outputImage set,
+    // outputImagePath is not required.
+    const ImageBuffer* originalImage;
+    ImageBuffer*       outputImage;
+} TlcAddSpotsArgs;
@@ -0,0 +1,126 @@
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <map>
+
+WorkerPool::WorkerPool(int threads)
+{
+    if (threads <= 0) {
+        threads = static_cast<int>(std::thread::hardware_concurrency());
+    }
+    for (int i = 1; i < threads; ++i) {
+        workers.emplace_back(&WorkerPool::worker_loop, this, i);
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& t : workers) {
+        t.join();
+    }
+}
+
+void WorkerPool::drain(int worker)
+{
+    size_t i;
+    while ((i = next.fetch_add(1)) < jobCount) {
+        try {
+            (*job)(i, worker);
+        } catch (...) {
+            errors[i] = std::current_exception();
+        }
+    }
+}
+
+void WorkerPool::worker_loop(int worker)
+{
+    unsigned long long seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+        }
+
+        drain(worker);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--active == 0) {
+            done.notify_one();
+        }
+    }
+}
+
+void WorkerPool::run(size_t count, const std::function<void(size_t, int)>& fn)
+{
+    if (count == 0) return;
+
+    std::lock_guard<std::mutex> runLock(runMutex);
+
+    errors.assign(count, nullptr);
+    job = &fn;
+    jobCount = count;
+    next.store(0);
+
+    // Not worth waking anyone for a single task (e.g. single-lane plates).
+    if (!workers.empty() && count > 1) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            active = static_cast<int>(workers.size());
+            ++generation;
+        }
+        wake.notify_all();
+        drain(0);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [&] { return active == 0; });
+    } else {
+        drain(0);
+    }
+
+    job = nullptr;
+    for (auto& e : errors) {
+        if (e) std::rethrow_exception(e);
+    }
+}
+
+namespace {
+    std::mutex& pools_mutex() {
+        static std::mutex m;
+        return m;
+    }
+
+    std::map<int, std::shared_ptr<WorkerPool>>& pools() {
+        static std::map<int, std::shared_ptr<WorkerPool>> p;
+        return p;
+    }
+}
+
+std::shared_ptr<WorkerPool> WorkerPool::shared(int threads)
+{
+    int cores = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    threads = threads <= 0 ? std::min(cores, kDefaultThreads) : std::min(threads, cores);
+
+    std::lock_guard<std::mutex> lock(pools_mutex());
+    auto& pool = pools()[threads];
+    if (!pool) {
+        pool = std::make_shared<WorkerPool>(threads);
+    }
+    return pool;
+}
+
+void WorkerPool::release_shared()
+{
+    // Swap out under the lock, destroy (join) outside it.
+    std::map<int, std::shared_ptr<WorkerPool>> dropped;
+    {
+        std::lock_guard<std::mutex> lock(pools_mutex());
+        dropped.swap(pools());
+    }
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Small fixed-size thread pool for fanning per-lane work out across cores.
+//
+// run(count, fn) calls fn(index, worker) once for every index in
+// [0, count) and blocks until all of them have finished; the calling
+// thread takes part as worker 0, so a pool of N runs at most N tasks at
+// once and worker is always in [0, size()) — callers index per-worker
+// scratch buffers with it. Tasks are handed out in index order but may
+// *finish* in any order, so callers write results into per-index slots
+// and merge afterwards if they need deterministic output.
+//
+// If any task throws, the remaining tasks still run, and run() rethrows
+// the exception from the lowest failing index once they're done.
+class WorkerPool
+{
+public:
+    explicit WorkerPool(int threads);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    int size() const { return static_cast<int>(workers.size()) + 1; }
+
+    void run(size_t count, const std::function<void(size_t, int)>& fn);
+
+    // Shared pool with the given thread count, created on first use.
+    // 0 means min(cores, kDefaultThreads); larger counts are capped at the
+    // core count. Concurrent run() calls on the same pool are serialised.
+    // Hold the returned pointer for the duration of the run: release_shared()
+    // may drop the registry's reference at any time.
+    static std::shared_ptr<WorkerPool> shared(int threads);
+
+    // Forgets every shared pool; each one's threads are joined once its
+    // last in-flight caller lets go of it.
+    static void release_shared();
+
+    static constexpr int kDefaultThreads = 4;
+
+private:
+    void worker_loop(int worker);
+    void drain(int worker);
+
+    std::vector<std::thread> workers;
+
+    std::mutex runMutex;            // one run() at a time
+    std::mutex mutex;               // guards the fields below
+    std::condition_variable wake;
+    std::condition_variable done;
+    const std::function<void(size_t, int)>* job = nullptr;
+    size_t jobCount = 0;
+    std::atomic<size_t> next{0};
+    std::vector<std::exception_ptr> errors;
+    unsigned long long generation = 0;
+    int active = 0;
+    bool stopping = false;
+};
@@ -8,11 +8,36 @@
 //                                        already-processed image without
 //                                        re-running any ONNX model; see its
 //                                        own doc comment below
-//   free_result(const char* ptr)       — frees the malloc'd result string
-//                                        returned by either of the above
+//   process_tlc_packed / add_manual_spots_packed
+//                                      — same inputs and pipelines, but
+//                                        return the packed binary layout
+//                                        from PackedResult.h instead of
+//                                        JSON (no formatting or parsing
+//                                        on either side)
+//   process_tlc_args / add_manual_spots_args (+ _packed)
+//                                      — the same calls taking the C
+//                                        structs from TlcArgs.h (numbers,
+//                                        box arrays, model handles)
+//                                        instead of one string
+//   tlc_open_model / tlc_close_model   — model handles for those structs;
+//                                        the structs can also carry raw
+//                                        pixel buffers in and out (see
+//                                        image_buffer.hpp) to skip the
+//                                        JPEG file round-trip entirely
+//   tlc_lane_worker_create / tlc_lane_worker_poll
+//                                      — lane detection on live camera
+//                                        frames (see frame_worker.hpp)
+//   free_result(const char* ptr)       — frees the malloc'd result
+//                                        returned by any of the above
+//   tlc_init_models(const char* args)  — optional warm-up: loads the spot
+//                                        (and strip) model sessions into
+//                                        the process-wide cache up front
+//   tlc_release_models()               — drops every cached model session,
+//                                        decoded image and annotation layer
+//                                        and stops the lane worker pools
 //
 // process_tlc input format (pipe-delimited string):
-//   image_path|model_path|baseline|topline|plot_output_path|manual_spots_str|strip_model_path
+//   image_path|model_path|baseline|topline|plot_output_path|manual_spots_str|strip_model_path|options
 //
 // manual_spots_str format:
 //   x1,y1,x2,y2;x1,y1,x2,y2;...   (semicolon-separated bounding boxes, in
@@ -24,13 +49,41 @@
 // detection yet, and keeps single-lane images working even if the strip
 // model is ever missing/corrupt.
 //
+// options is optional too: a comma-separated key=value list. Today it
+// carries the ONNX Runtime session policy for both models (see
+// SessionPolicy::parse in SpotDetector.h), e.g.
+//   intra=4,inter=2,mode=parallel,opt=all,spin=0,cache=/data/.../ort_cache
+// Empty keeps the mobile defaults (single intra-op thread, no model
+// cache). Passing cache= (an app-private writable directory) is what
+// makes the first frame after an app launch fast. One more key is read by
+// process_tlc itself rather than the session policy:
+//   lanes=N   worker threads for the per-lane pipeline (default 0 = one
+//             per core up to 4; 1 = fully serial)
+//   image_cache=MB
+//             budget of the decoded-image cache shared with
+//             add_manual_spots (default 192; 0 = off)
+//   output=PATH
+//             where the annotated image goes (default: overwrite
+//             image_path; the path can't contain ','). Keeping the
+//             original clean is what lets a later add_manual_spots on it
+//             reuse the image process_tlc decoded — an input that is
+//             about to be overwritten is never cached
+//   async=1, format=jpg|png|webp, quality=N
+//             how the annotated image is written (see output_writer.hpp).
+//             With async=1 the annotated image and densitogram are
+//             encoded on the writer thread and the result carries an
+//             "output_handle" for tlc_wait_output()
+//
 // process_tlc output: JSON string allocated with malloc (caller frees via
 // free_result).
 //   {
 //     "spots": [ { "id", "rf", "intensity", "auc", "confidence", "box",
 //                  "lane_id" }, ... ],   // flattened across all lanes,
 //                                        // sorted by rf ascending
-//     "plot_path": "...",
+//     "plot_path": "...",              // densitogram image is written
+//                                        // here (format from extension)
+//                                        // when the path is non-empty
+//     "output_handle": H,              // async=1 only
 //     "count": N
 //   }
 // -----------------------------------------------------------------------
@@ -43,6 +96,16 @@
 
 #include "SpotDetector.h"
 #include "AUCCalculator.h"
+#include "WorkerPool.h"
+#include "Geometry.h"
+#include "IntensityTable.h"
+#include "ImageCache.h"
+#include "Densitogram.h"
+#include "AnnotationLayer.h"
+#include "PackedResult.h"
+#include "TlcArgs.h"
+#include "../output_writer.hpp"
+#include "../frame_worker.hpp"
 
 #include <opencv2/opencv.hpp>
 
@@ -54,8 +117,12 @@
 #include <cstring>
 #include <algorithm>
 #include <cmath>
+#include <cerrno>
 #include <limits>
 #include <map>
+#include <mutex>
+#include <stdexcept>
+#include <cstddef>
 
 #ifdef __ANDROID__
 #include <android/log.h>
@@ -76,6 +143,86 @@ static std::vector<std::string> split_string(const std::string& s, char delim) {
     return tokens;
 }
 
+// Helper: look up one key in a "key=value,key=value" options string
+// (process_tlc's trailing field). Returns fallback if the key is absent.
+
+static std::string option_value(const std::string& options, const std::string& key, const std::string& fallback) {
+    for (const auto& item : split_string(options, ',')) {
+        size_t eq = item.find('=');
+        if (eq != std::string::npos && item.compare(0, eq, key) == 0 && eq == key.size()) {
+            return item.substr(eq + 1);
+        }
+    }
+    return fallback;
+}
+
+// Helpers: in-place parsing of the ';'-separated spot lists below.
+// Entries and fields are walked as pointer ranges over the caller's
+// string and numbers are read with strtof/strtod/strtol — no per-entry or
+// per-field std::string. Field splitting keeps std::getline's rules
+// (a trailing empty field doesn't count) so entry validity is unchanged,
+// and a field that doesn't start with a number throws like std::stof did.
+
+static int split_fields(const char* p, const char* end, const char** fields, int max_fields) {
+    int n = 0;
+    while (p < end) {
+        if (n < max_fields) fields[n] = p;
+        ++n;
+        const char* comma = static_cast<const char*>(std::memchr(p, ',', end - p));
+        if (!comma) break;
+        p = comma + 1;
+    }
+    return n;
+}
+
+// The parsers below only accept finite values of the target type: they
+// reject out-of-range input (ERANGE), nan and inf (which strtod accepts),
+// and longs that don't fit in an int.
+static double parse_number(const char* field) {
+    char* stop = nullptr;
+    errno = 0;
+    double v = std::strtod(field, &stop);
+    if (stop == field || errno == ERANGE || !std::isfinite(v)) {
+        throw std::invalid_argument("invalid number in spot list");
+    }
+    return v;
+}
+
+static float parse_float(const char* field) {
+    char* stop = nullptr;
+    errno = 0;
+    float v = std::strtof(field, &stop);
+    if (stop == field || errno == ERANGE || !std::isfinite(v)) {
+        throw std::invalid_argument("invalid number in spot list");
+    }
+    return v;
+}
+
+static int parse_int(const char* field) {
+    char* stop = nullptr;
+    errno = 0;
+    long v = std::strtol(field, &stop, 10);
+    if (stop == field || errno == ERANGE ||
+        v < std::numeric_limits<int>::min() || v > std::numeric_limits<int>::max()) {
+        throw std::invalid_argument("invalid number in spot list");
+    }
+    return static_cast<int>(v);
+}
+
+// Calls fn(entry_begin, entry_end) for every non-empty ';'-entry of s.
+template <typename Fn>
+static void for_each_entry(const std::string& s, Fn fn) {
+    const char* p = s.c_str();
+    const char* end = p + s.size();
+    while (p < end) {
+        const char* semi = static_cast<const char*>(std::memchr(p, ';', end - p));
+        const char* entry_end = semi ? semi : end;
+        if (entry_end > p) fn(p, entry_end);
+        if (!semi) break;
+        p = semi + 1;
+    }
+}
+
 // Helper: parse manual_spots_str  "x1,y1,x2,y2;x1,y1,x2,y2;..."
 // Coordinates are absolute image-pixel coordinates.
 // Returns Spot objects with confidence=1.0, cls=0.
@@ -83,45 +230,30 @@ static std::vector<std::string> split_string(const std::string& s, char delim) {
 static std::vector<Spot> parse_manual_spots(const std::string& manual_str) {
     std::vector<Spot> spots;
     if (manual_str.empty()) return spots;
+    spots.reserve(std::count(manual_str.begin(), manual_str.end(), ';') + 1);
 
-    auto entries = split_string(manual_str, ';');
-    for (const auto& entry : entries) {
-        if (entry.empty()) continue;
-        auto coords = split_string(entry, ',');
-        if (coords.size() < 4) continue;
+    for_each_entry(manual_str, [&](const char* p, const char* end) {
+        const char* f[4];
+        if (split_fields(p, end, f, 4) < 4) return;
 
         Spot s;
-        s.x1 = std::stof(coords[0]);
-        s.y1 = std::stof(coords[1]);
-        s.x2 = std::stof(coords[2]);
-        s.y2 = std::stof(coords[3]);
+        s.x1 = parse_float(f[0]);
+        s.y1 = parse_float(f[1]);
+        s.x2 = parse_float(f[2]);
+        s.y2 = parse_float(f[3]);
         s.confidence = 1.0f;
         s.cls = 0;
         spots.push_back(s);
-    }
+    });
     return spots;
 }
 
-// Helper: compute the mean intensity of a grayscale ROI (absolute coords)
-
-static double compute_mean_intensity(const cv::Mat& gray, float x1, float y1, float x2, float y2) {
-    int ix1 = std::max(0, static_cast<int>(x1));
-    int iy1 = std::max(0, static_cast<int>(y1));
-    int ix2 = std::min(gray.cols, static_cast<int>(x2));
-    int iy2 = std::min(gray.rows, static_cast<int>(y2));
-
-    if (ix2 <= ix1 || iy2 <= iy1) return 0.0;
-
-    cv::Mat roi = gray(cv::Rect(ix1, iy1, ix2 - ix1, iy2 - iy1));
-    cv::Scalar mean_val = cv::mean(roi);
-    return mean_val[0];
-}
-
-
 // Shared: Rf / intensity / AUC for one box (absolute coords), against the
 // baseline/topline convention used throughout this file. Used by both
 // process_tlc (for freshly-detected spots) and add_manual_spots (for a
 // spot the user drew after the fact) so the two call paths can't drift.
+// Mean intensity is a lookup in the image's summed-area table (see
+// IntensityTable.h), built once per call rather than once per spot.
 
 struct SpotMetrics {
     double rf;
@@ -130,7 +262,7 @@ struct SpotMetrics {
 };
 
 static SpotMetrics compute_spot_metrics(
-    const cv::Mat& gray,
+    const IntensityTable& intensity,
     float x1, float y1, float x2, float y2,
     double baseline, double topline
 ) {
@@ -143,13 +275,12 @@ static SpotMetrics compute_spot_metrics(
     float center_y = (y1 + y2) / 2.0f;
     m.rf = (static_cast<double>(center_y) - baseline) / lane_rf_height;
 
-    double mean_val = compute_mean_intensity(gray, x1, y1, x2, y2);
+    double mean_val = intensity.mean(static_cast<int>(x1), static_cast<int>(y1),
+                                     static_cast<int>(x2), static_cast<int>(y2));
     m.intensity = 255.0 - mean_val;
 
     double area = (double)(x2 - x1) * (y2 - y1);
-    std::vector<double> peak_x, peak_y;
-    AUCCalculator::generate_peak_data(m.rf, m.intensity, area, peak_x, peak_y);
-    m.auc = AUCCalculator::calculate_auc(peak_x, peak_y);
+    m.auc = AUCCalculator::peak_auc(m.intensity, area);
 
     return m;
 }
@@ -173,61 +304,9 @@ static std::string json_escape(const std::string& s) {
 }
 
 
-// Lane geometry + polygon-overlap manual-spot matching
-// (ported from the updated_backend CLI tool's multi-lane pipeline)
-
-static std::vector<cv::Point> box_to_quad(double x1, double y1, double x2, double y2) {
-    return {
-        cv::Point((int)x1, (int)y1),
-        cv::Point((int)x2, (int)y1),
-        cv::Point((int)x2, (int)y2),
-        cv::Point((int)x1, (int)y2)
-    };
-}
-
-// Rasterizes both quads onto a local mask to compute their overlap
-// percentage relative to the area of the smaller polygon.
-static double polygon_overlap_percent(const std::vector<cv::Point>& poly_a, const std::vector<cv::Point>& poly_b) {
-    std::vector<cv::Point> all_pts = poly_a;
-    all_pts.insert(all_pts.end(), poly_b.begin(), poly_b.end());
-    if (all_pts.empty()) return 0.0;
-
-    cv::Rect bounding_rect = cv::boundingRect(all_pts);
-    int min_x = bounding_rect.x;
-    int min_y = bounding_rect.y;
-    int w = std::max(bounding_rect.width + 2, 1);
-    int h = std::max(bounding_rect.height + 2, 1);
-
-    cv::Mat mask_a = cv::Mat::zeros(h, w, CV_8UC1);
-    cv::Mat mask_b = cv::Mat::zeros(h, w, CV_8UC1);
-
-    std::vector<cv::Point> local_a(poly_a.size());
-    for (size_t i = 0; i < poly_a.size(); ++i) {
-        local_a[i] = cv::Point(poly_a[i].x - min_x, poly_a[i].y - min_y);
-    }
-
-    std::vector<cv::Point> local_b(poly_b.size());
-    for (size_t i = 0; i < poly_b.size(); ++i) {
-        local_b[i] = cv::Point(poly_b[i].x - min_x, poly_b[i].y - min_y);
-    }
-
-    std::vector<std::vector<cv::Point>> pts_a = { local_a };
-    std::vector<std::vector<cv::Point>> pts_b = { local_b };
-
-    cv::fillPoly(mask_a, pts_a, cv::Scalar(1));
-    cv::fillPoly(mask_b, pts_b, cv::Scalar(1));
-
-    double area_a = cv::countNonZero(mask_a);
-    double area_b = cv::countNonZero(mask_b);
-    double min_area = std::min(area_a, area_b);
-    if (min_area == 0.0) return 0.0;
-
-    cv::Mat intersection_mask;
-    cv::bitwise_and(mask_a, mask_b, intersection_mask);
-    double intersection = cv::countNonZero(intersection_mask);
-
-    return (intersection / min_area) * 100.0;
-}
+// Manual-spot matching (ported from the updated_backend CLI tool's
+// multi-lane pipeline). Overlap geometry lives in Geometry.h, shared with
+// the desktop CLI.
 
 // Lane-adaptive overlap threshold: mean + 0.5 * std of non-zero overlaps.
 static double calculate_dynamic_threshold(const std::vector<double>& overlap_values, double min_thresh, double max_thresh) {
@@ -269,49 +348,32 @@ static MergeResult merge_manual_and_detected_spots(
     const std::vector<Spot>& manual_spots_local,
     const std::vector<Spot>& detected_spots
 ) {
-    std::vector<std::vector<cv::Point>> manual_quads;
-    manual_quads.reserve(manual_spots_local.size());
+    std::vector<Geometry::PixelBox> manual_boxes;
+    manual_boxes.reserve(manual_spots_local.size());
     for (const auto& m : manual_spots_local) {
-        manual_quads.push_back(box_to_quad(m.x1, m.y1, m.x2, m.y2));
+        manual_boxes.push_back(Geometry::to_pixel_box(m.x1, m.y1, m.x2, m.y2));
     }
 
-    std::vector<std::vector<cv::Point>> detected_quads;
-    detected_quads.reserve(detected_spots.size());
+    std::vector<Geometry::PixelBox> detected_boxes;
+    detected_boxes.reserve(detected_spots.size());
     for (const auto& s : detected_spots) {
-        detected_quads.push_back(box_to_quad(s.x1, s.y1, s.x2, s.y2));
+        detected_boxes.push_back(Geometry::to_pixel_box(s.x1, s.y1, s.x2, s.y2));
     }
 
-    std::vector<double> all_overlaps;
-    all_overlaps.reserve(manual_quads.size() * detected_quads.size());
-    std::vector<std::vector<double>> overlap_matrix(manual_quads.size(), std::vector<double>(detected_quads.size(), 0.0));
-
-    for (size_t i = 0; i < manual_quads.size(); ++i) {
-        for (size_t j = 0; j < detected_quads.size(); ++j) {
-            double ov = polygon_overlap_percent(manual_quads[i], detected_quads[j]);
-            overlap_matrix[i][j] = ov;
-            all_overlaps.push_back(ov);
-        }
-    }
+    // Only pairs that actually intersect are evaluated (see
+    // Geometry::match_overlaps); the threshold still sees every non-zero
+    // overlap, in the same order the dense matrix scan produced them.
+    Geometry::MatchResult matches = Geometry::match_overlaps(manual_boxes, detected_boxes);
+    const std::vector<double>& all_overlaps = matches.nonzeroOverlaps;
 
     double dynamic_threshold = calculate_dynamic_threshold(all_overlaps, 30.0, 85.0);
 
     std::vector<Spot> final_spots = detected_spots;
     std::vector<bool> confirmed_flags(final_spots.size(), false);
 
-    for (size_t i = 0; i < manual_quads.size(); ++i) {
-        int best_j = -1;
-        double best_overlap = 0.0;
-
-        if (!detected_quads.empty()) {
-            best_overlap = overlap_matrix[i][0];
-            best_j = 0;
-            for (size_t j = 1; j < detected_quads.size(); ++j) {
-                if (overlap_matrix[i][j] > best_overlap) {
-                    best_overlap = overlap_matrix[i][j];
-                    best_j = (int)j;
-                }
-            }
-        }
+    for (size_t i = 0; i < manual_boxes.size(); ++i) {
+        int best_j = matches.bestIndex[i];
+        double best_overlap = matches.bestOverlap[i];
 
         if (best_overlap >= dynamic_threshold && best_j != -1) {
             confirmed_flags[best_j] = true;
@@ -340,19 +402,28 @@ struct Lane {
     cv::Mat crop;
 };
 
- /*Detects lanes with the strip model, sorts them left-to-right, and always
- returns at least one lane — falling back to "whole image = one lane" if
+ /*Detects lanes with the strip model (an open session if the caller has
+ one, else loaded from strip_model_path), sorts them left-to-right, and
+ always returns at least one lane — falling back to "whole image = one lane" if
  the model is unavailable, fails to load, or detects nothing. This is
  what keeps single-lane images (and callers that don't pass a strip
- model at all) working exactly as before.*/
-
-static std::vector<Lane> detect_lanes(const cv::Mat& image, const std::string& strip_model_path) {
+ model at all) working exactly as before. with_crops = false leaves
+ lane.crop empty, for callers that only want the boxes (the live lane
+ worker), so no pixels are copied per frame.*/
+
+static std::vector<Lane> detect_lanes(const cv::Mat& image,
+                                      std::shared_ptr<SpotDetector> strip_detector,
+                                      const std::string& strip_model_path,
+                                      const SessionPolicy& policy,
+                                      bool with_crops = true) {
     std::vector<Lane> lanes;
 
-    if (!strip_model_path.empty()) {
+    if (strip_detector || !strip_model_path.empty()) {
         try {
-            SpotDetector strip_detector(strip_model_path);
-            std::vector<Spot> lane_detections = strip_detector.detect(image, 0.25f, 0.45f);
+            if (!strip_detector) {
+                strip_detector = SpotDetector::acquire(strip_model_path, policy);
+            }
+            std::vector<Spot> lane_detections = strip_detector->detect(image, 0.25f, 0.45f);
             LOGI("Lane detection returned %d candidate(s).", static_cast<int>(lane_detections.size()));
 
             for (const auto& det : lane_detections) {
@@ -374,7 +445,9 @@ static std::vector<Lane> detect_lanes(const cv::Mat& image, const std::string& s
                 int iy2 = std::max(0, std::min((int)lane.y2, image.rows));
 
                 if (ix2 > ix1 && iy2 > iy1) {
-                    lane.crop = image(cv::Rect(ix1, iy1, ix2 - ix1, iy2 - iy1)).clone();
+                    if (with_crops) {
+                        lane.crop = image(cv::Rect(ix1, iy1, ix2 - ix1, iy2 - iy1)).clone();
+                    }
                     lanes.push_back(lane);
                 }
             }
@@ -398,7 +471,9 @@ static std::vector<Lane> detect_lanes(const cv::Mat& image, const std::string& s
         lane.y1 = 0;
         lane.x2 = image.cols;
         lane.y2 = image.rows;
-        lane.crop = image.clone();
+        if (with_crops) {
+            lane.crop = image.clone();
+        }
         lanes.push_back(lane);
     }
 
@@ -461,217 +536,489 @@ struct SpotResult {
     float  x1, y1, x2, y2; // absolute image-pixel coordinates
 };
 
-// Exported C function: process_tlc
+static AnnotationLayer::SpotMark spot_mark(const SpotResult& r) {
+    return AnnotationLayer::SpotMark{ r.id, r.rf, r.x1, r.y1, r.x2, r.y2 };
+}
 
-extern "C" FFI_EXPORT
-const char* process_tlc(const char* json_args_str) {
-    try {
+// Per-worker scratch for process_lane(): reused across the lanes a worker
+// handles so the filtration pass doesn't reallocate for every lane.
+struct LaneScratch {
+    std::vector<Spot> filtered;
+};
 
-        // Parse pipe-delimited input
-        std::string input(json_args_str);
-        auto parts = split_string(input, '|');
-
-        // We expect up to 7 fields; pad with empty strings if fewer
-        // (strip_model_path is optional — see file header).
-        while (parts.size() < 7) parts.push_back("");
-
-        std::string image_path       = parts[0];
-        std::string model_path       = parts[1];
-        double      baseline         = std::stod(parts[2]);
-        double      topline          = std::stod(parts[3]);
-        std::string plot_output_path = parts[4];
-        std::string manual_spots_str = parts[5];
-        std::string strip_model_path = parts[6];
-
-        //Load the image
-        cv::Mat image = cv::imread(image_path, cv::IMREAD_COLOR);
-        if (image.empty()) {
-            const char* err = "{\"error\":\"Failed to load image\"}";
-            char* result = static_cast<char*>(std::malloc(std::strlen(err) + 1));
-            std::strcpy(result, err);
-            return result;
+/*Merge + filtration + metrics for one lane. Pure function of its inputs
+ (the intensity table is only read), so lanes can run concurrently on the worker pool.*/
+static std::vector<SpotResult> process_lane(
+    const Lane& lane,
+    const std::vector<Spot>& auto_spots,
+    const std::vector<Spot>& manual_spots_local,
+    const IntensityTable& intensity,
+    double baseline, double topline,
+    LaneScratch& scratch
+) {
+    MergeResult merged = merge_manual_and_detected_spots(manual_spots_local, auto_spots);
+
+     /*Filtration (resolution-aware, scoped to this lane's crop):
+       - Area filter:       0.01% <= area <= 25% of the lane's area
+       - Position filter:   |center_x - lane_center_x| < 0.45 * lane_width
+       - Confidence filter: confidence >= 0.0009
+     Manual/confirmed spots bypass all three — the user already
+     told us they're real.*/
+    double lane_width  = lane.crop.cols;
+    double lane_center = lane_width / 2.0;
+    double lane_area   = static_cast<double>(lane.crop.cols) * lane.crop.rows;
+    double min_area    = lane_area * 0.0001;
+    double max_area    = lane_area * 0.25;
+
+    std::vector<Spot>& filtered = scratch.filtered;
+    filtered.clear();
+    for (size_t i = 0; i < merged.spots.size(); ++i) {
+        const auto& s = merged.spots[i];
+
+        if (merged.confirmed_flags[i]) {
+            filtered.push_back(s);
+            continue;
         }
 
-        cv::Mat gray;
-        cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
+        float area = (s.x2 - s.x1) * (s.y2 - s.y1);
+        if (area < min_area || area > max_area) continue;
+        if (s.confidence < 0.0009f) continue;
 
-        // Detect lanes (always returns >= 1 lane; see detect_lanes)
-        std::vector<Lane> lanes = detect_lanes(image, strip_model_path);
-        LOGI("Active lanes: %d", static_cast<int>(lanes.size()));
+        float center_x = (s.x1 + s.x2) / 2.0f;
+        if (std::abs(center_x - lane_center) >= 0.45 * lane_width) continue;
 
-        //Parse manual spots (absolute coords) and assign to lanes
-        std::vector<Spot> manual_spots_absolute = parse_manual_spots(manual_spots_str);
-        std::vector<std::vector<Spot>> manual_spots_by_lane(lanes.size());
-        assign_manual_spots_to_lanes(manual_spots_absolute, lanes, manual_spots_by_lane);
+        filtered.push_back(s);
+    }
 
-         /*Spot detection + merge + filtration, per lane
-         One SpotDetector instance is reused across all lanes within
-         this single call — safe because the session never outlives
-         process_tlc() (see SpotDetector.h for why that boundary matters
-         on Android ARM64).*/
-        SpotDetector spot_detector(model_path);
+    LOGI("Lane %d: %d auto + %d manual -> %d survived filtration.",
+         lane.id, static_cast<int>(auto_spots.size()),
+         static_cast<int>(manual_spots_local.size()),
+         static_cast<int>(filtered.size()));
+
+     /*Rf / intensity / AUC — computed against the *absolute* image
+     and the single baseline/topline the caller supplied, exactly
+     like the pre-multi-lane pipeline (lane cropping only changes
+     where spots are *found*, not how Rf is defined).*/
+    std::vector<SpotResult> results;
+    results.reserve(filtered.size());
+    for (const auto& s : filtered) {
+        float abs_x1 = s.x1 + (float)lane.x1;
+        float abs_y1 = s.y1 + (float)lane.y1;
+        float abs_x2 = s.x2 + (float)lane.x1;
+        float abs_y2 = s.y2 + (float)lane.y1;
+
+        SpotMetrics metrics = compute_spot_metrics(
+            intensity, abs_x1, abs_y1, abs_x2, abs_y2, baseline, topline);
 
-        std::vector<SpotResult> results;
+        SpotResult r;
+        r.id = 0;
+        r.lane_id = lane.id;
+        r.rf = metrics.rf;
+        r.intensity = metrics.intensity;
+        r.auc = metrics.auc;
+        r.confidence = s.confidence;
+        r.x1 = abs_x1;
+        r.y1 = abs_y1;
+        r.x2 = abs_x2;
+        r.y2 = abs_y2;
+
+        results.push_back(r);
+    }
+    return results;
+}
 
-        for (const auto& lane : lanes) {
-            std::vector<Spot> auto_spots = spot_detector.detect(lane.crop, 0.0009f, 0.45f);
-
-            MergeResult merged = merge_manual_and_detected_spots(
-                manual_spots_by_lane[lane.id - 1], auto_spots);
-
-             /*Filtration (resolution-aware, scoped to this lane's crop):
-               - Area filter:       0.01% <= area <= 25% of the lane's area
-               - Position filter:   |center_x - lane_center_x| < 0.45 * lane_width
-               - Confidence filter: confidence >= 0.0009
-             Manual/confirmed spots bypass all three — the user already
-             told us they're real.*/
-            double lane_width  = lane.crop.cols;
-            double lane_center = lane_width / 2.0;
-            double lane_area   = static_cast<double>(lane.crop.cols) * lane.crop.rows;
-            double min_area    = lane_area * 0.0001;
-            double max_area    = lane_area * 0.25;
-
-            std::vector<Spot> filtered;
-            for (size_t i = 0; i < merged.spots.size(); ++i) {
-                const auto& s = merged.spots[i];
-
-                if (merged.confirmed_flags[i]) {
-                    filtered.push_back(s);
-                    continue;
-                }
+// Result serialisation. Both formats carry the same fields; JSON is what
+// the Dart side has always parsed, the packed buffer (PackedResult.h) can
+// be read in place through typed views with no parsing at all.
 
-                float area = (s.x2 - s.x1) * (s.y2 - s.y1);
-                if (area < min_area || area > max_area) continue;
-                if (s.confidence < 0.0009f) continue;
+static const char* malloc_copy(const std::string& str) {
+    char* result = static_cast<char*>(std::malloc(str.size() + 1));
+    if (result) {
+        std::memcpy(result, str.c_str(), str.size() + 1);
+    }
+    return result;
+}
 
-                float center_x = (s.x1 + s.x2) / 2.0f;
-                if (std::abs(center_x - lane_center) >= 0.45 * lane_width) continue;
+static const char* error_json(const char* what) {
+    return malloc_copy("{\"error\":\"" + json_escape(what) + "\"}");
+}
 
-                filtered.push_back(s);
-            }
+// plot_path is only emitted when non-null (process_tlc has one,
+// add_manual_spots doesn't).
+static std::string spots_json(const std::vector<SpotResult>& results, const std::string* plot_path,
+                              int64_t output_handle = 0) {
+    std::ostringstream json;
+    json << std::fixed << std::setprecision(4);
+
+    json << "{\"spots\":[";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const auto& r = results[i];
+        if (i > 0) json << ",";
+        json << "{"
+             << "\"id\":" << r.id << ","
+             << "\"lane_id\":" << r.lane_id << ","
+             << "\"rf\":" << r.rf << ","
+             << "\"intensity\":" << r.intensity << ","
+             << "\"auc\":" << r.auc << ","
+             << "\"confidence\":" << r.confidence << ","
+             << "\"box\":["
+             << r.x1 << "," << r.y1 << ","
+             << r.x2 << "," << r.y2
+             << "]"
+             << "}";
+    }
+    json << "],";
+    if (plot_path) {
+        json << "\"plot_path\":\"" << json_escape(*plot_path) << "\",";
+    }
+    if (output_handle) {
+        json << "\"output_handle\":" << output_handle << ",";
+    }
+    json << "\"count\":" << results.size();
+    json << "}";
+    return json.str();
+}
 
-            LOGI("Lane %d: %d auto + %d manual -> %d survived filtration.",
-                 lane.id, static_cast<int>(auto_spots.size()),
-                 static_cast<int>(manual_spots_by_lane[lane.id - 1].size()),
-                 static_cast<int>(filtered.size()));
-
-             /*Rf / intensity / AUC — computed against the *absolute* image
-             and the single baseline/topline the caller supplied, exactly
-             like the pre-multi-lane pipeline (lane cropping only changes
-             where spots are *found*, not how Rf is defined).*/
-            for (const auto& s : filtered) {
-                float abs_x1 = s.x1 + (float)lane.x1;
-                float abs_y1 = s.y1 + (float)lane.y1;
-                float abs_x2 = s.x2 + (float)lane.x1;
-                float abs_y2 = s.y2 + (float)lane.y1;
-
-                SpotMetrics metrics = compute_spot_metrics(
-                    gray, abs_x1, abs_y1, abs_x2, abs_y2, baseline, topline);
-
-                SpotResult r;
-                r.lane_id = lane.id;
-                r.rf = metrics.rf;
-                r.intensity = metrics.intensity;
-                r.auc = metrics.auc;
-                r.confidence = s.confidence;
-                r.x1 = abs_x1;
-                r.y1 = abs_y1;
-                r.x2 = abs_x2;
-                r.y2 = abs_y2;
-
-                results.push_back(r);
-            }
+// Builds one malloc'd TlcPackedHeader buffer: header, then the string
+// section (error, plot path — NUL-terminated), then one 8-byte-aligned
+// array per field. error == nullptr means success. Returns nullptr only if
+// the allocation itself fails.
+static const unsigned char* pack_results(const std::vector<SpotResult>& results,
+                                         const std::string& plot_path,
+                                         const char* error,
+                                         int64_t output_handle = 0) {
+    auto align8 = [](size_t n) { return (n + 7) & ~static_cast<size_t>(7); };
+
+    const size_t count = error ? 0 : results.size();
+    const size_t error_len = error ? std::strlen(error) : 0;
+
+    TlcPackedHeader h;
+    std::memset(&h, 0, sizeof(h));
+    h.magic      = TLC_PACKED_MAGIC;
+    h.version    = TLC_PACKED_VERSION;
+    h.headerSize = sizeof(TlcPackedHeader);
+    h.status     = error ? 1 : 0;
+    h.count      = static_cast<uint32_t>(count);
+    h.outputHandle = output_handle;
+
+    size_t off = align8(sizeof(TlcPackedHeader));
+    h.errorOffset = static_cast<uint32_t>(off);
+    h.errorLength = static_cast<uint32_t>(error_len);
+    off += error_len + 1;
+    h.plotPathOffset = static_cast<uint32_t>(off);
+    h.plotPathLength = static_cast<uint32_t>(plot_path.size());
+    off += plot_path.size() + 1;
+
+    off = align8(off); h.idOffset         = static_cast<uint32_t>(off); off += count * sizeof(int32_t);
+    off = align8(off); h.laneIdOffset     = static_cast<uint32_t>(off); off += count * sizeof(int32_t);
+    off = align8(off); h.rfOffset         = static_cast<uint32_t>(off); off += count * sizeof(double);
+    off = align8(off); h.intensityOffset  = static_cast<uint32_t>(off); off += count * sizeof(double);
+    off = align8(off); h.aucOffset        = static_cast<uint32_t>(off); off += count * sizeof(double);
+    off = align8(off); h.confidenceOffset = static_cast<uint32_t>(off); off += count * sizeof(float);
+    off = align8(off); h.boxOffset        = static_cast<uint32_t>(off); off += count * 4 * sizeof(float);
+    h.totalSize = static_cast<uint32_t>(off);
+
+    unsigned char* buf = static_cast<unsigned char*>(std::calloc(1, off));
+    if (!buf) return nullptr;
+
+    std::memcpy(buf, &h, sizeof(h));
+    if (error_len) std::memcpy(buf + h.errorOffset, error, error_len);
+    if (!plot_path.empty()) std::memcpy(buf + h.plotPathOffset, plot_path.data(), plot_path.size());
+
+    int32_t* ids         = reinterpret_cast<int32_t*>(buf + h.idOffset);
+    int32_t* lane_ids    = reinterpret_cast<int32_t*>(buf + h.laneIdOffset);
+    double*  rfs         = reinterpret_cast<double*>(buf + h.rfOffset);
+    double*  intensities = reinterpret_cast<double*>(buf + h.intensityOffset);
+    double*  aucs        = reinterpret_cast<double*>(buf + h.aucOffset);
+    float*   confidences = reinterpret_cast<float*>(buf + h.confidenceOffset);
+    float*   boxes       = reinterpret_cast<float*>(buf + h.boxOffset);
+
+    for (size_t i = 0; i < count; ++i) {
+        const SpotResult& r = results[i];
+        ids[i]         = r.id;
+        lane_ids[i]    = r.lane_id;
+        rfs[i]         = r.rf;
+        intensities[i] = r.intensity;
+        aucs[i]        = r.auc;
+        confidences[i] = r.confidence;
+        boxes[4 * i + 0] = r.x1;
+        boxes[4 * i + 1] = r.y1;
+        boxes[4 * i + 2] = r.x2;
+        boxes[4 * i + 3] = r.y2;
+    }
+    return buf;
+}
+
+// Annotated image goes to the caller's buffer when there is one, else to a
+// file. A too-small buffer is left untouched (its width/height then say
+// what's needed) rather than failing the whole analysis.
+
+static void write_annotated(const cv::Mat& image, ImageBuffer* buffer, const std::string& path) {
+    if (buffer) {
+        if (!image_to_buffer(image, buffer)) {
+            LOGI("Output buffer too small or unsupported format; annotated image not written.");
         }
+        return;
+    }
+    cv::imwrite(path, image);
+    // The file may have been an input too; don't let the cache hand out
+    // the old pixels.
+    ImageCache::shared().invalidate(path);
+}
 
-        //Sort by Rf ascending across all lanes, assign IDs
-        std::sort(results.begin(), results.end(),
-                  [](const SpotResult& a, const SpotResult& b) {
-                      return a.rf < b.rf;
-                  });
-        for (int i = 0; i < static_cast<int>(results.size()); ++i) {
-            results[i].id = i + 1;
+// Input image for one call: the caller's decoded buffer when given (never
+// cached — there is no key to find it by again), else the file through
+// the shared ImageCache. keep = false for a file the call will overwrite.
+
+static std::shared_ptr<const DecodedImage> decode_input(const cv::Mat& provided, const std::string& path,
+                                                        bool keep = true) {
+    std::shared_ptr<const DecodedImage> decoded =
+        provided.empty() ? ImageCache::shared().load(path, keep) : DecodedImage::from_bgr(provided);
+    if (!decoded) {
+        throw std::runtime_error("Failed to load image");
+    }
+    return decoded;
+}
+
+// Options key image_cache=<MB> resizes the decoded-image cache (0 turns it
+// off); absent leaves the current budget alone.
+
+static void apply_image_cache_option(const std::string& options) {
+    std::string mb = option_value(options, "image_cache", "");
+    if (!mb.empty()) {
+        ImageCache::shared().set_budget(static_cast<size_t>(std::max(0, std::stoi(mb))) * 1024u * 1024u);
+    }
+}
+
+// Parsed process_tlc arguments (string format in the file header).
+
+struct ProcessTlcRequest {
+    std::string       image_path;
+    std::string       output_image_path; // empty = overwrite image_path
+    std::string       model_path;
+    double            baseline = 0.0;
+    double            topline  = 0.0;
+    std::string       plot_output_path;
+    std::vector<Spot> manual_spots;      // absolute image-pixel coordinates
+    std::string       strip_model_path;
+    SessionPolicy     policy;
+    int               lane_threads = 0;
+    OutputOptions     output;            // encoder + async (output_writer.hpp)
+
+    // Already-open sessions (TlcModel handles); when set they are used
+    // instead of model_path / strip_model_path.
+    std::shared_ptr<SpotDetector> spot_model;
+    std::shared_ptr<SpotDetector> strip_model;
+
+    // Raw-buffer callers (see image_buffer.hpp): a decoded frame used
+    // instead of reading image_path, and a buffer that receives the
+    // annotated image instead of a file.
+    cv::Mat      image;
+    ImageBuffer* output_buffer = nullptr;
+};
+
+static ProcessTlcRequest parse_process_tlc_args(const char* args) {
+    auto parts = split_string(args ? std::string(args) : std::string(), '|');
+
+    // We expect up to 8 fields; pad with empty strings if fewer
+    // (strip_model_path and options are optional — see file header).
+    while (parts.size() < 8) parts.push_back("");
+
+    ProcessTlcRequest req;
+    req.image_path       = parts[0];
+    req.model_path       = parts[1];
+    req.baseline         = std::stod(parts[2]);
+    req.topline          = std::stod(parts[3]);
+    req.plot_output_path = parts[4];
+    req.manual_spots     = parse_manual_spots(parts[5]);
+    req.strip_model_path = parts[6];
+    req.policy           = SessionPolicy::parse(parts[7]);
+    req.lane_threads     = std::stoi(option_value(parts[7], "lanes", "0"));
+    req.output           = parse_output_options(parts[7]);
+    req.output_image_path = option_value(parts[7], "output", "");
+    apply_image_cache_option(parts[7]);
+    return req;
+}
+
+/* Pipeline core shared by process_tlc and process_tlc_packed: lanes, spot
+ detection, merge/filtration, metrics, the annotated image and the
+ densitogram. Returns every spot sorted by Rf with IDs assigned; throws on
+ failure so each entry point reports errors in its own result format.
+ With req.output.async the files are queued instead of written and
+ *output_handle receives their tlc_wait_output() handle (else 0).*/
+
+static std::vector<SpotResult> run_process_tlc(const ProcessTlcRequest& req, int64_t* output_handle) {
+    //Load the image (through the decoded-image cache for file inputs).
+    // The cached BGR is shared, so annotation happens on a private copy.
+    // An input about to be overwritten with the annotated image isn't
+    // kept: the entry would be invalidated as soon as it is written.
+    bool overwrites_input = !req.output_buffer &&
+        (req.output_image_path.empty() || req.output_image_path == req.image_path);
+    std::shared_ptr<const DecodedImage> decoded = decode_input(req.image, req.image_path, !overwrites_input);
+    cv::Mat image = req.image.empty() ? decoded->bgr.clone() : req.image;
+    const IntensityTable& intensity = decoded->intensity;
+
+    // Detect lanes (always returns >= 1 lane; see detect_lanes)
+    SessionPolicy strip_policy = req.policy;
+    strip_policy.optimizedModelPath.clear();
+    std::vector<Lane> lanes = detect_lanes(image, req.strip_model, req.strip_model_path, strip_policy);
+    LOGI("Active lanes: %d", static_cast<int>(lanes.size()));
+
+    //Assign manual spots (absolute coords) to lanes
+    std::vector<std::vector<Spot>> manual_spots_by_lane(lanes.size());
+    assign_manual_spots_to_lanes(req.manual_spots, lanes, manual_spots_by_lane);
+
+     /*Spot detection + merge + filtration, per lane
+     The spot model session comes from the process-wide registry
+     (see SpotDetector::acquire), so only the first call after launch
+     — or after tlc_release_models() — pays for loading the graph.*/
+    std::shared_ptr<SpotDetector> spot_detector =
+        req.spot_model ? req.spot_model : SpotDetector::acquire(req.model_path, req.policy);
+
+    // All lane crops go through the spot model together in a single
+    // batched Run when the model allows it (see detect_batch);
+    // otherwise each lane worker below runs its own detect().
+    bool batched = spot_detector->supports_batch() && lanes.size() > 1;
+    std::vector<std::vector<Spot>> auto_spots_by_lane;
+    if (batched) {
+        std::vector<cv::Mat> lane_crops;
+        lane_crops.reserve(lanes.size());
+        for (const auto& lane : lanes) {
+            lane_crops.push_back(lane.crop);
         }
+        auto_spots_by_lane = spot_detector->detect_batch(lane_crops, 0.0009f, 0.45f);
+    }
 
-        //Draw lane outlines + spot boxes on the original image
-        static const cv::Scalar lane_colors[] = {
-            cv::Scalar(255, 128, 0), cv::Scalar(0, 200, 255), cv::Scalar(200, 0, 255),
-            cv::Scalar(255, 0, 128), cv::Scalar(128, 255, 0),
-        };
-        if (lanes.size() > 1) {
-            for (const auto& lane : lanes) {
-                cv::rectangle(image,
-                              cv::Point((int)lane.x1, (int)lane.y1),
-                              cv::Point((int)lane.x2, (int)lane.y2),
-                              lane_colors[(lane.id - 1) % 5], 1);
-            }
+    // Per-lane merge / filtration / metrics (and spot detection too,
+    // when the model can't batch) fan out over the worker pool. Each
+    // lane writes only its own slot, and the slots are concatenated in
+    // lane order, so the Rf sort below sees exactly the sequence the
+    // serial loop used to produce — output is identical either way.
+    std::shared_ptr<WorkerPool> poolRef = WorkerPool::shared(req.lane_threads);
+    WorkerPool& pool = *poolRef;
+    std::vector<LaneScratch> scratch(pool.size());
+    std::vector<std::vector<SpotResult>> results_by_lane(lanes.size());
+
+    pool.run(lanes.size(), [&](size_t lane_idx, int worker) {
+        const Lane& lane = lanes[lane_idx];
+        std::vector<Spot> own_spots;
+        if (!batched) {
+            own_spots = spot_detector->detect(lane.crop, 0.0009f, 0.45f);
         }
+        const std::vector<Spot>& auto_spots = batched ? auto_spots_by_lane[lane_idx] : own_spots;
 
-        for (const auto& r : results) {
-            cv::rectangle(image, cv::Point(static_cast<int>(r.x1), static_cast<int>(r.y1)),
-                          cv::Point(static_cast<int>(r.x2), static_cast<int>(r.y2)),
-                          cv::Scalar(0, 255, 0), 2);
+        results_by_lane[lane_idx] = process_lane(
+            lane, auto_spots, manual_spots_by_lane[lane_idx],
+            intensity, req.baseline, req.topline, scratch[worker]);
+    });
 
-            char label[64];
-            std::snprintf(label, sizeof(label), "%d Rf:%.2f", r.id, r.rf);
+    std::vector<SpotResult> results;
+    for (const auto& lane_results : results_by_lane) {
+        results.insert(results.end(), lane_results.begin(), lane_results.end());
+    }
 
-            int text_baseline = 0;
-            cv::Size textSize = cv::getTextSize(label, cv::FONT_HERSHEY_SIMPLEX, 0.6, 1, &text_baseline);
-            cv::Point textOrg(static_cast<int>(r.x1), static_cast<int>(r.y1) - 5);
+    //Sort by Rf ascending across all lanes, assign IDs
+    std::sort(results.begin(), results.end(),
+              [](const SpotResult& a, const SpotResult& b) {
+                  return a.rf < b.rf;
+              });
+    for (int i = 0; i < static_cast<int>(results.size()); ++i) {
+        results[i].id = i + 1;
+    }
 
+    //Draw lane outlines + spot boxes on the original image
+    if (lanes.size() > 1) {
+        for (const auto& lane : lanes) {
             cv::rectangle(image,
-                          textOrg + cv::Point(0, text_baseline),
-                          textOrg + cv::Point(textSize.width, -textSize.height),
-                          cv::Scalar(0, 255, 0),
-                          cv::FILLED);
-
-            cv::putText(image, label,
-                        textOrg,
-                        cv::FONT_HERSHEY_SIMPLEX, 0.6, cv::Scalar(0, 0, 0), 1, cv::LINE_AA);
+                          cv::Point((int)lane.x1, (int)lane.y1),
+                          cv::Point((int)lane.x2, (int)lane.y2),
+                          Densitogram::lane_color(lane.id), 1);
         }
-        cv::imwrite(image_path, image);
-
-        //Build JSON result string manually
-        std::ostringstream json;
-        json << std::fixed << std::setprecision(4);
-
-        json << "{\"spots\":[";
-        for (size_t i = 0; i < results.size(); ++i) {
-            const auto& r = results[i];
-            if (i > 0) json << ",";
-            json << "{"
-                 << "\"id\":" << r.id << ","
-                 << "\"lane_id\":" << r.lane_id << ","
-                 << "\"rf\":" << r.rf << ","
-                 << "\"intensity\":" << r.intensity << ","
-                 << "\"auc\":" << r.auc << ","
-                 << "\"confidence\":" << r.confidence << ","
-                 << "\"box\":["
-                 << r.x1 << "," << r.y1 << ","
-                 << r.x2 << "," << r.y2
-                 << "]"
-                 << "}";
+    }
+
+    for (const auto& r : results) {
+        AnnotationLayer::draw_spot(image, spot_mark(r));
+    }
+    // Files to write: the annotated image (unless it goes to a caller
+    // buffer) and the densitogram.
+    std::vector<OutputFile> outputs;
+    if (req.output_buffer) {
+        write_annotated(image, req.output_buffer, std::string());
+    } else {
+        outputs.push_back(OutputFile{ image,
+                                      req.output_image_path.empty() ? req.image_path : req.output_image_path,
+                                      req.output });
+    }
+
+    // Densitogram: one Gaussian per spot, summed per lane on a shared
+    // Rf axis (see Densitogram.h). Skipped when no path was given.
+    if (!req.plot_output_path.empty()) {
+        std::vector<Densitogram::Peak> peaks;
+        peaks.reserve(results.size());
+        for (const auto& r : results) {
+            Densitogram::Peak p;
+            p.lane = r.lane_id - 1;
+            p.spotId = r.id;
+            p.rf = r.rf;
+            p.intensity = r.intensity;
+            p.area = (double)(r.x2 - r.x1) * (r.y2 - r.y1);
+            peaks.push_back(p);
         }
-        json << "],";
-        json << "\"plot_path\":\"" << json_escape(plot_output_path) << "\",";
-        json << "\"count\":" << results.size();
-        json << "}";
-
-        //Allocate result with malloc and return
-        std::string json_str = json.str();
-        char* result = static_cast<char*>(std::malloc(json_str.size() + 1));
-        if (result) {
-            std::memcpy(result, json_str.c_str(), json_str.size() + 1);
+        outputs.push_back(OutputFile{ Densitogram::render(peaks, static_cast<int>(lanes.size())),
+                                      req.plot_output_path, OutputOptions() });
+    }
+
+    // Written files may have been inputs too (process_tlc overwrites its
+    // image by default); don't let the cache hand out the old pixels.
+    std::vector<std::string> written;
+    for (const auto& f : outputs) written.push_back(f.path);
+    auto invalidate = [written]() {
+        for (const auto& path : written) ImageCache::shared().invalidate(path);
+    };
+
+    *output_handle = 0;
+    if (req.output.async && !outputs.empty()) {
+        *output_handle = queue_outputs(std::move(outputs), invalidate);
+    } else {
+        for (const auto& f : outputs) {
+            if (!write_output(f)) {
+                LOGI("Failed to write %s", f.path.c_str());
+            }
         }
-        return result;
+        invalidate();
+    }
+
+    return results;
+}
+
+// Exported C function: process_tlc
 
+extern "C" FFI_EXPORT
+const char* process_tlc(const char* json_args_str) {
+    try {
+        ProcessTlcRequest req = parse_process_tlc_args(json_args_str);
+        int64_t handle = 0;
+        std::vector<SpotResult> results = run_process_tlc(req, &handle);
+        return malloc_copy(spots_json(results, &req.plot_output_path, handle));
     } catch (const std::exception& e) {
         // Return error JSON on any exception
-        std::string err = "{\"error\":\"" + json_escape(e.what()) + "\"}";
-        char* result = static_cast<char*>(std::malloc(err.size() + 1));
-        if (result) {
-            std::memcpy(result, err.c_str(), err.size() + 1);
-        }
-        return result;
+        return error_json(e.what());
+    }
+}
+
+// Exported C function: process_tlc_packed
+// Same input and pipeline as process_tlc; returns a TlcPackedHeader buffer
+// (see PackedResult.h) instead of JSON. Release it with free_result.
+
+extern "C" FFI_EXPORT
+const unsigned char* process_tlc_packed(const char* json_args_str) {
+    try {
+        ProcessTlcRequest req = parse_process_tlc_args(json_args_str);
+        int64_t handle = 0;
+        std::vector<SpotResult> results = run_process_tlc(req, &handle);
+        return pack_results(results, req.plot_output_path, nullptr, handle);
+    } catch (const std::exception& e) {
+        return pack_results(std::vector<SpotResult>(), std::string(), e.what());
     }
 }
 
@@ -683,29 +1030,149 @@ const char* process_tlc(const char* json_args_str) {
 static std::vector<SpotResult> parse_existing_spots(const std::string& s) {
     std::vector<SpotResult> spots;
     if (s.empty()) return spots;
+    spots.reserve(std::count(s.begin(), s.end(), ';') + 1);
 
-    auto entries = split_string(s, ';');
-    for (const auto& entry : entries) {
-        if (entry.empty()) continue;
-        auto f = split_string(entry, ',');
-        if (f.size() < 8) continue;
+    for_each_entry(s, [&](const char* p, const char* end) {
+        const char* f[9];
+        int n = split_fields(p, end, f, 9);
+        if (n < 8) return;
 
         SpotResult r;
         r.id = 0;
-        r.lane_id = (f.size() >= 9) ? std::stoi(f[8]) : 1;
-        r.x1 = std::stof(f[0]);
-        r.y1 = std::stof(f[1]);
-        r.x2 = std::stof(f[2]);
-        r.y2 = std::stof(f[3]);
-        r.rf = std::stod(f[4]);
-        r.intensity = std::stod(f[5]);
-        r.auc = std::stod(f[6]);
-        r.confidence = std::stof(f[7]);
+        r.lane_id = (n >= 9) ? parse_int(f[8]) : 1;
+        r.x1 = parse_float(f[0]);
+        r.y1 = parse_float(f[1]);
+        r.x2 = parse_float(f[2]);
+        r.y2 = parse_float(f[3]);
+        r.rf = parse_number(f[4]);
+        r.intensity = parse_number(f[5]);
+        r.auc = parse_number(f[6]);
+        r.confidence = parse_float(f[7]);
         spots.push_back(r);
-    }
+    });
     return spots;
 }
 
+// Parsed add_manual_spots arguments (string format in the doc comment
+// below).
+
+struct AddManualSpotsRequest {
+    std::string             original_image_path;
+    std::string             output_image_path;
+    cv::Mat                 original_image;         // raw-buffer callers
+    ImageBuffer*            output_buffer = nullptr; // as in ProcessTlcRequest
+    double                  baseline = 0.0;
+    double                  topline  = 0.0;
+    std::vector<SpotResult> existing_spots;
+    std::vector<Spot>       new_boxes;
+};
+
+static AddManualSpotsRequest parse_add_manual_spots_args(const char* args) {
+    auto parts = split_string(args ? std::string(args) : std::string(), '|');
+    while (parts.size() < 6) parts.push_back("");
+
+    AddManualSpotsRequest req;
+    req.original_image_path = parts[0];
+    req.output_image_path   = parts[1];
+    req.baseline            = std::stod(parts[2]);
+    req.topline             = std::stod(parts[3]);
+    req.existing_spots      = parse_existing_spots(parts[4]);
+    req.new_boxes           = parse_manual_spots(parts[5]);
+    return req;
+}
+
+// Core shared by add_manual_spots and add_manual_spots_packed; returns the
+// combined, renumbered spot list and throws on failure.
+
+static std::vector<SpotResult> run_add_manual_spots(const AddManualSpotsRequest& req) {
+    // Repeated calls on the same plate (one per drawn box) hit the
+    // decoded-image cache instead of decoding the original again.
+    std::shared_ptr<const DecodedImage> decoded = decode_input(req.original_image, req.original_image_path);
+    const IntensityTable& intensity = decoded->intensity;
+
+    std::vector<SpotResult> results = req.existing_spots;
+
+    // Build lane X-boundaries from existing spots so we can assign
+    // new spots to the correct lane without re-running lane detection.
+    // Map: lane_id -> (min_x1, max_x2) across all existing spots in that lane.
+    std::map<int, std::pair<float, float>> lane_bounds;
+    for (const auto& es : results) {
+        auto it = lane_bounds.find(es.lane_id);
+        if (it == lane_bounds.end()) {
+            lane_bounds[es.lane_id] = {es.x1, es.x2};
+        } else {
+            it->second.first  = std::min(it->second.first,  es.x1);
+            it->second.second = std::max(it->second.second, es.x2);
+        }
+    }
+
+    // New spots: compute metrics fresh, never filtered.
+    const std::vector<Spot>& new_boxes = req.new_boxes;
+    for (const auto& nb : new_boxes) {
+        SpotMetrics metrics = compute_spot_metrics(
+            intensity, nb.x1, nb.y1, nb.x2, nb.y2, req.baseline, req.topline);
+
+        SpotResult r;
+        // Assign to the lane whose X-span contains the new spot's center,
+        // or the nearest lane by horizontal distance.
+        float center_x = (nb.x1 + nb.x2) / 2.0f;
+        int best_lane = 1;
+        float best_dist = std::numeric_limits<float>::max();
+        for (const auto& lb : lane_bounds) {
+            float dist;
+            if (center_x >= lb.second.first && center_x <= lb.second.second) {
+                dist = 0.0f;
+            } else {
+                dist = std::min(std::abs(center_x - lb.second.first),
+                                std::abs(center_x - lb.second.second));
+            }
+            if (dist < best_dist) {
+                best_dist = dist;
+                best_lane = lb.first;
+            }
+        }
+        r.lane_id = best_lane;
+        r.rf = metrics.rf;
+        r.intensity = metrics.intensity;
+        r.auc = metrics.auc;
+        r.confidence = 1.0f;
+        r.x1 = nb.x1;
+        r.y1 = nb.y1;
+        r.x2 = nb.x2;
+        r.y2 = nb.y2;
+
+        results.push_back(r);
+    }
+
+    LOGI("add_manual_spots: %d existing + %d new = %d total.",
+         static_cast<int>(results.size() - new_boxes.size()),
+         static_cast<int>(new_boxes.size()),
+         static_cast<int>(results.size()));
+
+    std::sort(results.begin(), results.end(),
+              [](const SpotResult& a, const SpotResult& b) {
+                  return a.rf < b.rf;
+              });
+    for (int i = 0; i < static_cast<int>(results.size()); ++i) {
+        results[i].id = i + 1;
+    }
+
+    // Annotate the clean original. For file inputs the layer keeps the
+    // previous result and only repaints the spots whose box or label
+    // changed (see AnnotationLayer.h), so each extra box costs a few
+    // label redraws instead of a full copy + redraw.
+    std::vector<AnnotationLayer::SpotMark> marks;
+    marks.reserve(results.size());
+    for (const auto& r : results) {
+        marks.push_back(spot_mark(r));
+    }
+    std::shared_ptr<const cv::Mat> annotated = AnnotationLayer::render(
+        req.original_image.empty() ? req.original_image_path : std::string(), decoded->bgr, marks);
+    write_annotated(*annotated, req.output_buffer, req.output_image_path);
+
+    return results;
+}
+
 /* Exported C function: add_manual_spots
 
  Adds one or more user-drawn spots to an already-processed image without
@@ -724,7 +1191,9 @@ static std::vector<SpotResult> parse_existing_spots(const std::string& s) {
  renumbered from scratch, then drawn together onto a fresh copy of the
  *original* (clean) image — never onto the already-annotated one. That
  matters: if a new spot's Rf falls between two existing ones, the old
- spots' baked-in ID labels would otherwise go stale.
+ spots' baked-in ID labels would otherwise go stale. (Repeat calls on the
+ same file only repaint the spots that changed, with the same result as
+ a full redraw; see AnnotationLayer.h.)
 
  Output JSON has the same shape as process_tlc's "spots" array, so the
  existing NewTlcResult/NewTlcSpot Dart parsing code is reused unchanged.*/
@@ -732,164 +1201,342 @@ static std::vector<SpotResult> parse_existing_spots(const std::string& s) {
 extern "C" FFI_EXPORT
 const char* add_manual_spots(const char* json_args_str) {
     try {
-        std::string input(json_args_str);
-        auto parts = split_string(input, '|');
-        while (parts.size() < 6) parts.push_back("");
-
-        std::string original_image_path = parts[0];
-        std::string output_image_path   = parts[1];
-        double      baseline            = std::stod(parts[2]);
-        double      topline             = std::stod(parts[3]);
-        std::string existing_spots_str  = parts[4];
-        std::string new_boxes_str       = parts[5];
-
-        cv::Mat image = cv::imread(original_image_path, cv::IMREAD_COLOR);
-        if (image.empty()) {
-            const char* err = "{\"error\":\"Failed to load image\"}";
-            char* result = static_cast<char*>(std::malloc(std::strlen(err) + 1));
-            std::strcpy(result, err);
-            return result;
-        }
+        AddManualSpotsRequest req = parse_add_manual_spots_args(json_args_str);
+        return malloc_copy(spots_json(run_add_manual_spots(req), nullptr));
+    } catch (const std::exception& e) {
+        return error_json(e.what());
+    }
+}
 
-        cv::Mat gray;
-        cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
+// Exported C function: add_manual_spots_packed
+// Same as add_manual_spots, but returns a TlcPackedHeader buffer (see
+// PackedResult.h) instead of JSON. Release it with free_result.
 
-        std::vector<SpotResult> results = parse_existing_spots(existing_spots_str);
+extern "C" FFI_EXPORT
+const unsigned char* add_manual_spots_packed(const char* json_args_str) {
+    try {
+        AddManualSpotsRequest req = parse_add_manual_spots_args(json_args_str);
+        return pack_results(run_add_manual_spots(req), std::string(), nullptr);
+    } catch (const std::exception& e) {
+        return pack_results(std::vector<SpotResult>(), std::string(), e.what());
+    }
+}
 
-        // Build lane X-boundaries from existing spots so we can assign
-        // new spots to the correct lane without re-running lane detection.
-        // Map: lane_id -> (min_x1, max_x2) across all existing spots in that lane.
-        std::map<int, std::pair<float, float>> lane_bounds;
-        for (const auto& es : results) {
-            auto it = lane_bounds.find(es.lane_id);
-            if (it == lane_bounds.end()) {
-                lane_bounds[es.lane_id] = {es.x1, es.x2};
-            } else {
-                it->second.first  = std::min(it->second.first,  es.x1);
-                it->second.second = std::max(it->second.second, es.x2);
-            }
-        }
+/* Structured entry points (TlcArgs.h)
 
-        // New spots: compute metrics fresh, never filtered.
-        std::vector<Spot> new_boxes = parse_manual_spots(new_boxes_str);
-        for (const auto& nb : new_boxes) {
-            SpotMetrics metrics = compute_spot_metrics(
-                gray, nb.x1, nb.y1, nb.x2, nb.y2, baseline, topline);
-
-            SpotResult r;
-            // Assign to the lane whose X-span contains the new spot's center,
-            // or the nearest lane by horizontal distance.
-            float center_x = (nb.x1 + nb.x2) / 2.0f;
-            int best_lane = 1;
-            float best_dist = std::numeric_limits<float>::max();
-            for (const auto& lb : lane_bounds) {
-                float dist;
-                if (center_x >= lb.second.first && center_x <= lb.second.second) {
-                    dist = 0.0f;
-                } else {
-                    dist = std::min(std::abs(center_x - lb.second.first),
-                                    std::abs(center_x - lb.second.second));
-                }
-                if (dist < best_dist) {
-                    best_dist = dist;
-                    best_lane = lb.first;
-                }
-            }
-            r.lane_id = best_lane;
-            r.rf = metrics.rf;
-            r.intensity = metrics.intensity;
-            r.auc = metrics.auc;
-            r.confidence = 1.0f;
-            r.x1 = nb.x1;
-            r.y1 = nb.y1;
-            r.x2 = nb.x2;
-            r.y2 = nb.y2;
-
-            results.push_back(r);
-        }
+ Same pipelines as the string API — the pipe-delimited exports above are
+ now thin front-ends that parse into the same request structs these fill
+ directly from the caller's arrays, with no formatting or parsing on
+ either side.*/
+
+struct TlcModel {
+    std::shared_ptr<SpotDetector> detector;
+};
+
+static std::string c_str_or_empty(const char* s) {
+    return s ? std::string(s) : std::string();
+}
 
-        LOGI("add_manual_spots: %d existing + %d new = %d total.",
-             static_cast<int>(results.size() - new_boxes.size()),
-             static_cast<int>(new_boxes.size()),
-             static_cast<int>(results.size()));
-
-        std::sort(results.begin(), results.end(),
-                  [](const SpotResult& a, const SpotResult& b) {
-                      return a.rf < b.rf;
-                  });
-        for (int i = 0; i < static_cast<int>(results.size()); ++i) {
-            results[i].id = i + 1;
+static ProcessTlcRequest request_from_args(const TlcProcessArgs* args) {
+    if (!args || args->structSize < offsetof(TlcProcessArgs, image)) {
+        throw std::invalid_argument("TlcProcessArgs missing or structSize too small");
+    }
+
+    ProcessTlcRequest req;
+    req.image_path        = c_str_or_empty(args->imagePath);
+    req.output_image_path = c_str_or_empty(args->outputImagePath);
+    req.plot_output_path  = c_str_or_empty(args->plotOutputPath);
+    req.model_path        = c_str_or_empty(args->spotModelPath);
+    req.strip_model_path  = c_str_or_empty(args->stripModelPath);
+    req.baseline          = args->baseline;
+    req.topline           = args->topline;
+
+    std::string options = c_str_or_empty(args->options);
+    req.policy       = SessionPolicy::parse(options);
+    req.lane_threads = std::stoi(option_value(options, "lanes", "0"));
+    req.output       = parse_output_options(options);
+    apply_image_cache_option(options);
+
+    // Fields appended after the first revision are only read when the
+    // caller's struct is big enough to have them.
+    if (args->structSize >= sizeof(TlcProcessArgs)) {
+        if (args->image) {
+            req.image = image_from_buffer(args->image);
+            if (req.image.empty()) throw std::invalid_argument("invalid image buffer");
         }
+        req.output_buffer = args->outputImage;
+    }
 
-        // Draw every box + label fresh onto the clean original image.
-        for (const auto& r : results) {
-            cv::rectangle(image, cv::Point(static_cast<int>(r.x1), static_cast<int>(r.y1)),
-                          cv::Point(static_cast<int>(r.x2), static_cast<int>(r.y2)),
-                          cv::Scalar(0, 255, 0), 2);
+    if (args->spotModel)  req.spot_model  = args->spotModel->detector;
+    if (args->stripModel) req.strip_model = args->stripModel->detector;
+    if (!req.spot_model && req.model_path.empty()) {
+        throw std::invalid_argument("no spot model given");
+    }
+    if (args->manualSpotCount && !args->manualSpots) {
+        throw std::invalid_argument("manualSpots is NULL");
+    }
+
+    req.manual_spots.reserve(args->manualSpotCount);
+    for (uint32_t i = 0; i < args->manualSpotCount; ++i) {
+        const TlcBox& b = args->manualSpots[i];
+        Spot s;
+        s.x1 = b.x1;
+        s.y1 = b.y1;
+        s.x2 = b.x2;
+        s.y2 = b.y2;
+        s.confidence = 1.0f;
+        s.cls = 0;
+        req.manual_spots.push_back(s);
+    }
+    return req;
+}
 
-            char label[64];
-            std::snprintf(label, sizeof(label), "%d Rf:%.2f", r.id, r.rf);
+static AddManualSpotsRequest request_from_args(const TlcAddSpotsArgs* args) {
+    if (!args || args->structSize < offsetof(TlcAddSpotsArgs, originalImage)) {
+        throw std::invalid_argument("TlcAddSpotsArgs missing or structSize too small");
+    }
+    const bool has_buffers = args->structSize >= sizeof(TlcAddSpotsArgs);
+    ImageBuffer* output_buffer = has_buffers ? args->outputImage : nullptr;
+    if (!output_buffer && (!args->outputImagePath || !*args->outputImagePath)) {
+        throw std::invalid_argument("outputImagePath is required");
+    }
 
-            int text_baseline = 0;
-            cv::Size textSize = cv::getTextSize(label, cv::FONT_HERSHEY_SIMPLEX, 0.6, 1, &text_baseline);
-            cv::Point textOrg(static_cast<int>(r.x1), static_cast<int>(r.y1) - 5);
+    if ((args->existingSpotCount && !args->existingSpots) || (args->newBoxCount && !args->newBoxes)) {
+        throw std::invalid_argument("spot array is NULL");
+    }
 
-            cv::rectangle(image,
-                          textOrg + cv::Point(0, text_baseline),
-                          textOrg + cv::Point(textSize.width, -textSize.height),
-                          cv::Scalar(0, 255, 0),
-                          cv::FILLED);
-
-            cv::putText(image, label,
-                        textOrg,
-                        cv::FONT_HERSHEY_SIMPLEX, 0.6, cv::Scalar(0, 0, 0), 1, cv::LINE_AA);
-        }
-        cv::imwrite(output_image_path, image);
-
-        // Build JSON result — same "spots" shape as process_tlc.
-        std::ostringstream json;
-        json << std::fixed << std::setprecision(4);
-
-        json << "{\"spots\":[";
-        for (size_t i = 0; i < results.size(); ++i) {
-            const auto& r = results[i];
-            if (i > 0) json << ",";
-            json << "{"
-                 << "\"id\":" << r.id << ","
-                 << "\"lane_id\":" << r.lane_id << ","
-                 << "\"rf\":" << r.rf << ","
-                 << "\"intensity\":" << r.intensity << ","
-                 << "\"auc\":" << r.auc << ","
-                 << "\"confidence\":" << r.confidence << ","
-                 << "\"box\":["
-                 << r.x1 << "," << r.y1 << ","
-                 << r.x2 << "," << r.y2
-                 << "]"
-                 << "}";
-        }
-        json << "],";
-        json << "\"count\":" << results.size();
-        json << "}";
-
-        std::string json_str = json.str();
-        char* result = static_cast<char*>(std::malloc(json_str.size() + 1));
-        if (result) {
-            std::memcpy(result, json_str.c_str(), json_str.size() + 1);
+    AddManualSpotsRequest req;
+    req.original_image_path = c_str_or_empty(args->originalImagePath);
+    req.output_image_path   = c_str_or_empty(args->outputImagePath);
+    req.output_buffer       = output_buffer;
+    req.baseline            = args->baseline;
+    req.topline             = args->topline;
+
+    if (has_buffers && args->originalImage) {
+        req.original_image = image_from_buffer(args->originalImage);
+        if (req.original_image.empty()) throw std::invalid_argument("invalid image buffer");
+    }
+
+    req.existing_spots.reserve(args->existingSpotCount);
+    for (uint32_t i = 0; i < args->existingSpotCount; ++i) {
+        const TlcSpotRecord& e = args->existingSpots[i];
+        SpotResult r;
+        r.id = 0;
+        r.lane_id = e.laneId;
+        r.rf = e.rf;
+        r.intensity = e.intensity;
+        r.auc = e.auc;
+        r.confidence = e.confidence;
+        r.x1 = e.box.x1;
+        r.y1 = e.box.y1;
+        r.x2 = e.box.x2;
+        r.y2 = e.box.y2;
+        req.existing_spots.push_back(r);
+    }
+
+    req.new_boxes.reserve(args->newBoxCount);
+    for (uint32_t i = 0; i < args->newBoxCount; ++i) {
+        const TlcBox& b = args->newBoxes[i];
+        Spot s;
+        s.x1 = b.x1;
+        s.y1 = b.y1;
+        s.x2 = b.x2;
+        s.y2 = b.y2;
+        s.confidence = 1.0f;
+        s.cls = 0;
+        req.new_boxes.push_back(s);
+    }
+    return req;
+}
+
+// Exported C functions: tlc_open_model / tlc_close_model
+// Opens (or reuses, via the model registry) a session for model_path under
+// the given options string and returns a handle for TlcProcessArgs;
+// NULL if it fails to load. Close every handle that was opened — the
+// session itself stays cached until tlc_release_models().
+
+extern "C" FFI_EXPORT
+TlcModel* tlc_open_model(const char* model_path, const char* options) {
+    try {
+        if (!model_path || !*model_path) return nullptr;
+        TlcModel* model = new TlcModel;
+        try {
+            model->detector = SpotDetector::acquire(model_path, SessionPolicy::parse(c_str_or_empty(options)));
+        } catch (...) {
+            delete model;
+            throw;
         }
-        return result;
+        return model;
+    } catch (const std::exception& e) {
+        LOGI("tlc_open_model failed: %s", e.what());
+        return nullptr;
+    }
+}
+
+extern "C" FFI_EXPORT
+void tlc_close_model(TlcModel* model) {
+    delete model;
+}
+
+// Exported C functions: process_tlc_args / process_tlc_args_packed
+// Struct-argument forms of process_tlc / process_tlc_packed; results and
+// ownership are identical (release with free_result).
 
+extern "C" FFI_EXPORT
+const char* process_tlc_args(const TlcProcessArgs* args) {
+    try {
+        ProcessTlcRequest req = request_from_args(args);
+        int64_t handle = 0;
+        std::vector<SpotResult> results = run_process_tlc(req, &handle);
+        return malloc_copy(spots_json(results, &req.plot_output_path, handle));
     } catch (const std::exception& e) {
-        std::string err = "{\"error\":\"" + json_escape(e.what()) + "\"}";
-        char* result = static_cast<char*>(std::malloc(err.size() + 1));
-        if (result) {
-            std::memcpy(result, err.c_str(), err.size() + 1);
+        return error_json(e.what());
+    }
+}
+
+extern "C" FFI_EXPORT
+const unsigned char* process_tlc_args_packed(const TlcProcessArgs* args) {
+    try {
+        ProcessTlcRequest req = request_from_args(args);
+        int64_t handle = 0;
+        std::vector<SpotResult> results = run_process_tlc(req, &handle);
+        return pack_results(results, req.plot_output_path, nullptr, handle);
+    } catch (const std::exception& e) {
+        return pack_results(std::vector<SpotResult>(), std::string(), e.what());
+    }
+}
+
+// Exported C functions: add_manual_spots_args / add_manual_spots_args_packed
+// Struct-argument forms of add_manual_spots / add_manual_spots_packed.
+
+extern "C" FFI_EXPORT
+const char* add_manual_spots_args(const TlcAddSpotsArgs* args) {
+    try {
+        AddManualSpotsRequest req = request_from_args(args);
+        return malloc_copy(spots_json(run_add_manual_spots(req), nullptr));
+    } catch (const std::exception& e) {
+        return error_json(e.what());
+    }
+}
+
+extern "C" FFI_EXPORT
+const unsigned char* add_manual_spots_args_packed(const TlcAddSpotsArgs* args) {
+    try {
+        AddManualSpotsRequest req = request_from_args(args);
+        return pack_results(run_add_manual_spots(req), std::string(), nullptr);
+    } catch (const std::exception& e) {
+        return pack_results(std::vector<SpotResult>(), std::string(), e.what());
+    }
+}
+
+// Latest lane-worker result, already serialized for polling.
+struct LaneWorkerResults {
+    std::mutex  mutex;
+    std::string json = "{\"frame\":0,\"lanes\":[]}";
+};
+
+// Exported C functions: tlc_lane_worker_create / tlc_lane_worker_poll
+// A FrameWorker (frame_worker.hpp) that runs strip-model lane detection
+// on the newest pushed frame, at working_size on the longer side (0 =
+// 640). Push frames, read stats and destroy it with the frame_worker_*
+// functions. The model handle only has to stay open until this returns.
+//
+// Poll result (malloc'd JSON, release with free_result), lanes sorted
+// left to right, boxes normalized to the frame:
+//   {"frame":N,"lanes":[{"id":1,"box":[x1,y1,x2,y2]},...]}
+// frame is the push count the lanes came from (0 = none yet).
+
+extern "C" FFI_EXPORT
+FrameWorker* tlc_lane_worker_create(TlcModel* strip_model, int working_size) {
+    try {
+        if (!strip_model || !strip_model->detector) return nullptr;
+        std::shared_ptr<SpotDetector> detector = strip_model->detector;
+        auto results = std::make_shared<LaneWorkerResults>();
+        LaneWorkerResults* raw = results.get();
+
+        auto job = [detector, raw](const cv::Mat& frame, int64_t index) {
+            std::vector<Lane> lanes = detect_lanes(frame, detector, std::string(), SessionPolicy(), false);
+
+            std::ostringstream json;
+            json << std::fixed << std::setprecision(4);
+            json << "{\"frame\":" << index << ",\"lanes\":[";
+            for (size_t i = 0; i < lanes.size(); ++i) {
+                const Lane& l = lanes[i];
+                if (i > 0) json << ",";
+                json << "{\"id\":" << l.id << ",\"box\":["
+                     << l.x1 / frame.cols << "," << l.y1 / frame.rows << ","
+                     << l.x2 / frame.cols << "," << l.y2 / frame.rows << "]}";
+            }
+            json << "]}";
+
+            std::lock_guard<std::mutex> lock(raw->mutex);
+            raw->json = json.str();
+        };
+        return new FrameWorker(FRAME_WORKER_LANES, job, working_size > 0 ? working_size : 640, results);
+    } catch (const std::exception& e) {
+        LOGI("tlc_lane_worker_create failed: %s", e.what());
+        return nullptr;
+    }
+}
+
+extern "C" FFI_EXPORT
+const char* tlc_lane_worker_poll(FrameWorker* worker) {
+    if (!worker || worker->kind != FRAME_WORKER_LANES) {
+        return error_json("not a lane worker");
+    }
+    LaneWorkerResults* results = static_cast<LaneWorkerResults*>(worker->context.get());
+    std::lock_guard<std::mutex> lock(results->mutex);
+    return malloc_copy(results->json);
+}
+
+/* Exported C function: tlc_init_models
+
+ Input format (pipe-delimited string): model_path|strip_model_path|options
+ strip_model_path and options are optional, as in process_tlc — pass the
+ same options string process_tlc will get, since sessions are cached per
+ session policy. Loads both sessions into the registry so the first process_tlc() after app launch doesn't pay for
+ graph loading on the user's critical path. Calling it is never required —
+ process_tlc() loads lazily on a cache miss either way.
+
+ Returns 1 if every requested model loaded, 0 otherwise.*/
+
+extern "C" FFI_EXPORT
+int tlc_init_models(const char* args) {
+    try {
+        auto parts = split_string(args ? std::string(args) : std::string(), '|');
+        while (parts.size() < 3) parts.push_back("");
+
+        if (parts[0].empty()) return 0;
+        SessionPolicy policy = SessionPolicy::parse(parts[2]);
+        apply_image_cache_option(parts[2]);
+        SpotDetector::acquire(parts[0], policy);
+        if (!parts[1].empty()) {
+            SessionPolicy strip_policy = policy;
+            strip_policy.optimizedModelPath.clear();
+            SpotDetector::acquire(parts[1], strip_policy);
         }
-        return result;
+        return 1;
+    } catch (const std::exception& e) {
+        LOGI("tlc_init_models failed: %s", e.what());
+        return 0;
     }
 }
 
+// Exported C function: tlc_release_models
+// Frees every cached model session, decoded image and annotation layer,
+// and stops the lane worker threads (e.g. when the TLC screen is closed and the memory is better spent
+// elsewhere). Safe to call at any time.
+extern "C" FFI_EXPORT
+void tlc_release_models() {
+    SpotDetector::release_all();
+    ImageCache::shared().clear();
+    AnnotationLayer::clear();
+    WorkerPool::release_shared();
+}
+
 // Exported C function: free_result
-// Frees a string previously returned by process_tlc or add_manual_spots.
+// Frees a result previously returned by process_tlc, add_manual_spots or
+// either of their _packed variants.
 extern "C" FFI_EXPORT
 void free_result(const char* ptr) {
     if (ptr) {
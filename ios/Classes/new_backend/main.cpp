@@ -2,8 +2,8 @@
 // -----------------------------------------------------------------------
 // Standalone desktop CLI for local testing of the multi-lane TLC pipeline.
 // NOT part of the Flutter app build (see android/CMakeLists.txt — only
-// ffi_exports.cpp + SpotDetector.cpp + RFCalculator.cpp + AUCCalculator.cpp
-// are compiled into the plugin). This mirrors ffi_exports.cpp's pipeline
+// ffi_exports.cpp and the backend modules it uses are compiled into the
+// plugin). This mirrors ffi_exports.cpp's pipeline
 // closely enough to be useful for debugging on a desktop machine with a
 // windowing system, but the app itself always goes through process_tlc().
 // -----------------------------------------------------------------------
@@ -20,6 +20,9 @@
 #include "SpotDetector.h"
 #include "RFCalculator.h"
 #include "AUCCalculator.h"
+#include "Geometry.h"
+#include "IntensityTable.h"
+#include "Densitogram.h"
 
 struct FinalSpot {
     int id; // 1-indexed within the lane
@@ -58,60 +61,6 @@ void mouse_click(int event, int x, int y, int flags, void* userdata) {
     }
 }
 
-// Convert an axis-aligned bounding box into a 4-point quadrilateral (quad)
-std::vector<cv::Point> box_to_quad(double x1, double y1, double x2, double y2) {
-    return {
-        cv::Point((int)x1, (int)y1),
-        cv::Point((int)x2, (int)y1),
-        cv::Point((int)x2, (int)y2),
-        cv::Point((int)x1, (int)y2)
-    };
-}
-
-// Rasterizes both quads onto a local mask to compute their overlap percentage
-// relative to the area of the smaller polygon
-double polygon_overlap_percent(const std::vector<cv::Point>& poly_a, const std::vector<cv::Point>& poly_b) {
-    std::vector<cv::Point> all_pts = poly_a;
-    all_pts.insert(all_pts.end(), poly_b.begin(), poly_b.end());
-    if (all_pts.empty()) return 0.0;
-
-    cv::Rect bounding_rect = cv::boundingRect(all_pts);
-    int min_x = bounding_rect.x;
-    int min_y = bounding_rect.y;
-    int w = std::max(bounding_rect.width + 2, 1);
-    int h = std::max(bounding_rect.height + 2, 1);
-
-    cv::Mat mask_a = cv::Mat::zeros(h, w, CV_8UC1);
-    cv::Mat mask_b = cv::Mat::zeros(h, w, CV_8UC1);
-
-    std::vector<cv::Point> local_a(poly_a.size());
-    for (size_t i = 0; i < poly_a.size(); ++i) {
-        local_a[i] = cv::Point(poly_a[i].x - min_x, poly_a[i].y - min_y);
-    }
-
-    std::vector<cv::Point> local_b(poly_b.size());
-    for (size_t i = 0; i < poly_b.size(); ++i) {
-        local_b[i] = cv::Point(poly_b[i].x - min_x, poly_b[i].y - min_y);
-    }
-
-    std::vector<std::vector<cv::Point>> pts_a = { local_a };
-    std::vector<std::vector<cv::Point>> pts_b = { local_b };
-
-    cv::fillPoly(mask_a, pts_a, cv::Scalar(1));
-    cv::fillPoly(mask_b, pts_b, cv::Scalar(1));
-
-    double area_a = cv::countNonZero(mask_a);
-    double area_b = cv::countNonZero(mask_b);
-    double min_area = std::min(area_a, area_b);
-    if (min_area == 0.0) return 0.0;
-
-    cv::Mat intersection_mask;
-    cv::bitwise_and(mask_a, mask_b, intersection_mask);
-    double intersection = cv::countNonZero(intersection_mask);
-
-    return (intersection / min_area) * 100.0;
-}
-
 // Computes the lane-adaptive overlap threshold: mean + 0.5 * std of non-zero overlaps
 double calculate_dynamic_threshold(const std::vector<double>& overlap_values, double min_thresh = 30.0, double max_thresh = 85.0) {
     std::vector<double> nonzero;
@@ -140,30 +89,24 @@ struct MergeResult {
     double dynamic_threshold;
 };
 
-// Compares manual quads against raw detections to link them or insert new manual spots
+// Compares manual boxes against raw detections to link them or insert new manual spots
 MergeResult merge_manual_and_detected_spots(
-    const std::vector<std::vector<cv::Point>>& manual_quads,
+    const std::vector<Geometry::PixelBox>& manual_boxes,
     const std::vector<Spot>& detected_spots,
     double min_thresh = 30.0,
     double max_thresh = 85.0
 ) {
-    std::vector<std::vector<cv::Point>> detected_quads;
-    detected_quads.reserve(detected_spots.size());
+    std::vector<Geometry::PixelBox> detected_boxes;
+    detected_boxes.reserve(detected_spots.size());
     for (const auto& s : detected_spots) {
-        detected_quads.push_back(box_to_quad(s.x1, s.y1, s.x2, s.y2));
+        detected_boxes.push_back(Geometry::to_pixel_box(s.x1, s.y1, s.x2, s.y2));
     }
 
-    std::vector<double> all_overlaps;
-    all_overlaps.reserve(manual_quads.size() * detected_quads.size());
-    std::vector<std::vector<double>> overlap_matrix(manual_quads.size(), std::vector<double>(detected_quads.size(), 0.0));
-
-    for (size_t i = 0; i < manual_quads.size(); ++i) {
-        for (size_t j = 0; j < detected_quads.size(); ++j) {
-            double ov = polygon_overlap_percent(manual_quads[i], detected_quads[j]);
-            overlap_matrix[i][j] = ov;
-            all_overlaps.push_back(ov);
-        }
-    }
+    // Only pairs that actually intersect are evaluated (see
+    // Geometry::match_overlaps); the threshold still sees every non-zero
+    // overlap, in the same order the dense matrix scan produced them.
+    Geometry::MatchResult matches = Geometry::match_overlaps(manual_boxes, detected_boxes);
+    const std::vector<double>& all_overlaps = matches.nonzeroOverlaps;
 
     double dynamic_threshold = calculate_dynamic_threshold(all_overlaps, min_thresh, max_thresh);
 
@@ -173,20 +116,9 @@ MergeResult merge_manual_and_detected_spots(
     std::cout << "\nManual overlap report (dynamic threshold = " << std::fixed << std::setprecision(2) << dynamic_threshold << "):" << std::endl;
     std::printf("%-15s %-18s %-16s %-30s\n", "Manual Spot #", "Best Overlap %", "Threshold Used", "Status");
 
-    for (size_t i = 0; i < manual_quads.size(); ++i) {
-        int best_j = -1;
-        double best_overlap = 0.0;
-
-        if (!detected_quads.empty()) {
-            best_overlap = overlap_matrix[i][0];
-            best_j = 0;
-            for (size_t j = 1; j < detected_quads.size(); ++j) {
-                if (overlap_matrix[i][j] > best_overlap) {
-                    best_overlap = overlap_matrix[i][j];
-                    best_j = (int)j;
-                }
-            }
-        }
+    for (size_t i = 0; i < manual_boxes.size(); ++i) {
+        int best_j = matches.bestIndex[i];
+        double best_overlap = matches.bestOverlap[i];
 
         std::string status;
         if (best_overlap >= dynamic_threshold && best_j != -1) {
@@ -195,23 +127,11 @@ MergeResult merge_manual_and_detected_spots(
             ss << "matched detection #" << best_j + 1 << " -> forced through filter";
             status = ss.str();
         } else {
-            // Find bounding box for manual quad
-            double min_x = manual_quads[i][0].x;
-            double max_x = manual_quads[i][0].x;
-            double min_y = manual_quads[i][0].y;
-            double max_y = manual_quads[i][0].y;
-            for (const auto& pt : manual_quads[i]) {
-                if (pt.x < min_x) min_x = pt.x;
-                if (pt.x > max_x) max_x = pt.x;
-                if (pt.y < min_y) min_y = pt.y;
-                if (pt.y > max_y) max_y = pt.y;
-            }
-
             Spot manual_spot;
-            manual_spot.x1 = (float)min_x;
-            manual_spot.y1 = (float)min_y;
-            manual_spot.x2 = (float)max_x;
-            manual_spot.y2 = (float)max_y;
+            manual_spot.x1 = (float)manual_boxes[i].x1;
+            manual_spot.y1 = (float)manual_boxes[i].y1;
+            manual_spot.x2 = (float)manual_boxes[i].x2;
+            manual_spot.y2 = (float)manual_boxes[i].y2;
             manual_spot.confidence = 1.0f;
             manual_spot.cls = -1; // -1 flags manual
 
@@ -239,6 +159,7 @@ int main(int argc, char* argv[]) {
         bool verbose = false;
         std::string manual_spots_str = "";
         std::string plot_output_path = "densitogram.png";
+        SessionPolicy policy;
 
         // Parse command line arguments
         for (int i = 1; i < argc; ++i) {
@@ -255,6 +176,21 @@ int main(int argc, char* argv[]) {
                 manual_spots_str = argv[++i];
             } else if (arg == "--output-plot" && i + 1 < argc) {
                 plot_output_path = argv[++i];
+            } else if (arg == "--intra-threads" && i + 1 < argc) {
+                policy.intraOpThreads = std::stoi(argv[++i]);
+            } else if (arg == "--inter-threads" && i + 1 < argc) {
+                policy.interOpThreads = std::stoi(argv[++i]);
+            } else if (arg == "--parallel") {
+                policy.parallelExecution = true;
+            } else if (arg == "--opt-level" && i + 1 < argc) {
+                // Same spellings as the FFI options string: disable|basic|extended|all
+                policy.optimizationLevel = SessionPolicy::parse(std::string("opt=") + argv[++i]).optimizationLevel;
+            } else if (arg == "--no-spin") {
+                policy.allowSpinning = false;
+            } else if (arg == "--save-optimized" && i + 1 < argc) {
+                policy.optimizedModelPath = argv[++i];
+            } else if (arg == "--model-cache" && i + 1 < argc) {
+                policy.cacheDir = argv[++i];
             } else {
                 if (arg.rfind("--", 0) != 0) {
                     static int positional_count = 0;
@@ -271,6 +207,7 @@ int main(int argc, char* argv[]) {
             std::cout << "Loading lane detector: " << strip_model_path << std::endl;
             std::cout << "Loading spot detector: " << spot_model_path << std::endl;
             std::cout << "Headless mode: " << (headless ? "ENABLED" : "DISABLED") << std::endl;
+            std::cout << "Session policy: " << policy.key() << std::endl;
         }
 
         cv::Mat image = cv::imread(img_path);
@@ -320,7 +257,9 @@ int main(int argc, char* argv[]) {
         }
 
         // 1. Run Lane/Strip Detection
-        SpotDetector strip_detector(strip_model_path);
+        SessionPolicy strip_policy = policy;
+        strip_policy.optimizedModelPath.clear(); // --save-optimized applies to the spot model
+        SpotDetector strip_detector(strip_model_path, strip_policy);
         std::vector<Spot> lane_detections = strip_detector.detect(image, 0.25f, 0.45f);
 
         std::vector<Lane> lanes;
@@ -383,10 +322,17 @@ int main(int argc, char* argv[]) {
         }
 
         // 2. Spot Detection per Lane
-        SpotDetector spot_detector(spot_model_path);
+        SpotDetector spot_detector(spot_model_path, policy);
+
+        std::vector<cv::Mat> lane_crops;
+        for (const auto& lane : lanes) {
+            lane_crops.push_back(lane.crop);
+        }
+        std::vector<std::vector<Spot>> auto_spots_by_lane = spot_detector.detect_batch(lane_crops, 0.0009f, 0.45f);
 
-        for (auto& lane : lanes) {
-            std::vector<Spot> auto_spots = spot_detector.detect(lane.crop, 0.0009f, 0.45f);
+        for (size_t lane_idx = 0; lane_idx < lanes.size(); ++lane_idx) {
+            Lane& lane = lanes[lane_idx];
+            const std::vector<Spot>& auto_spots = auto_spots_by_lane[lane_idx];
 
             std::vector<cv::Point> clicked_points;
 
@@ -444,18 +390,18 @@ int main(int argc, char* argv[]) {
                 cv::destroyWindow(win_name);
             }
 
-            // Build manual quads from clicked points
-            std::vector<std::vector<cv::Point>> manual_quads;
+            // Build manual boxes from clicked points
+            std::vector<Geometry::PixelBox> manual_boxes;
             int box_size = 20;
             for (const auto& pt : clicked_points) {
-                manual_quads.push_back(box_to_quad(pt.x - box_size, pt.y - box_size, pt.x + box_size, pt.y + box_size));
+                manual_boxes.push_back(Geometry::to_pixel_box(pt.x - box_size, pt.y - box_size, pt.x + box_size, pt.y + box_size));
             }
 
             std::vector<Spot> spots;
             std::vector<bool> confirmed_flags;
 
-            if (!manual_quads.empty()) {
-                MergeResult merge_res = merge_manual_and_detected_spots(manual_quads, auto_spots);
+            if (!manual_boxes.empty()) {
+                MergeResult merge_res = merge_manual_and_detected_spots(manual_boxes, auto_spots);
                 spots = merge_res.spots;
                 confirmed_flags = merge_res.confirmed_flags;
             } else {
@@ -501,7 +447,12 @@ int main(int argc, char* argv[]) {
                 filtered_spots.push_back(spot);
             }
 
-            // 4. Calculate intensities and Rf values
+            // 4. Calculate intensities and Rf values. One summed-area table
+            // per lane crop; each spot's mean is then an O(1) lookup.
+            cv::Mat lane_gray;
+            cv::cvtColor(lane.crop, lane_gray, cv::COLOR_BGR2GRAY);
+            IntensityTable lane_intensity(lane_gray);
+
             for (const auto& spot : filtered_spots) {
                 int ix1 = std::max(0, std::min((int)spot.x1, lane.crop.cols - 1));
                 int iy1 = std::max(0, std::min((int)spot.y1, lane.crop.rows - 1));
@@ -513,11 +464,8 @@ int main(int argc, char* argv[]) {
 
                 double intensity = 0.0;
                 if (w > 0 && h > 0) {
-                    cv::Mat spot_crop = lane.crop(cv::Rect(ix1, iy1, w, h));
-                    cv::Mat gray;
-                    cv::cvtColor(spot_crop, gray, cv::COLOR_BGR2GRAY);
-                    cv::Scalar mean_val = cv::mean(255 - gray);
-                    intensity = mean_val[0] / 255.0; // Normalized to [0, 1]
+                    double mean_gray = lane_intensity.mean(ix1, iy1, ix2, iy2);
+                    intensity = (255.0 - mean_gray) / 255.0; // Normalized to [0, 1]
                 }
 
                 double spot_center_y = (spot.y1 + spot.y2) / 2.0;
@@ -550,14 +498,11 @@ int main(int argc, char* argv[]) {
             for (size_t k = 0; k < lane.spots.size(); ++k) {
                 lane.spots[k].id = (int)(k + 1);
 
-                std::vector<double> peak_x;
-                std::vector<double> peak_y;
                 double box_width = lane.spots[k].x2 - lane.spots[k].x1;
                 double box_height = lane.spots[k].y2 - lane.spots[k].y1;
                 double area = box_width * box_height;
 
-                AUCCalculator::generate_peak_data(lane.spots[k].rf, lane.spots[k].intensity, area, peak_x, peak_y);
-                lane.spots[k].auc = AUCCalculator::calculate_auc(peak_x, peak_y);
+                lane.spots[k].auc = AUCCalculator::peak_auc(lane.spots[k].intensity, area);
             }
         }
 
@@ -570,6 +515,28 @@ int main(int argc, char* argv[]) {
             }
         }
 
+        // Densitogram: per-lane Rf profiles (see Densitogram.h)
+        if (!plot_output_path.empty()) {
+            std::vector<Densitogram::Peak> peaks;
+            for (const auto& lane : lanes) {
+                for (const auto& spot : lane.spots) {
+                    Densitogram::Peak p;
+                    p.lane = lane.id - 1;
+                    p.spotId = spot.id;
+                    p.rf = spot.rf;
+                    p.intensity = spot.intensity;
+                    p.area = (spot.x2 - spot.x1) * (spot.y2 - spot.y1);
+                    peaks.push_back(p);
+                }
+            }
+            cv::Mat plot = Densitogram::render(peaks, (int)lanes.size());
+            if (cv::imwrite(plot_output_path, plot)) {
+                std::cout << "Densitogram saved to " << plot_output_path << std::endl;
+            } else {
+                std::cerr << "Failed to write densitogram to " << plot_output_path << std::endl;
+            }
+        }
+
         // 6. Structured JSON Output
         std::cout << "\nJSON_OUTPUT_START\n";
         std::cout << "{\n";
@@ -0,0 +1,207 @@
+#include "output_writer.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <opencv2/imgcodecs.hpp>
+
+namespace {
+    // Results of finished jobs nobody has waited on yet; the oldest are
+    // dropped past this many so fire-and-forget callers don't grow it.
+    const size_t kMaxFinished = 256;
+
+    struct Job
+    {
+        int64_t handle;
+        std::vector<OutputFile> files;
+        std::function<void()> on_done;
+    };
+
+    class Writer
+    {
+    public:
+        Writer() : thread_(&Writer::run, this) {}
+
+        ~Writer()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stop_ = true;
+            }
+            work_.notify_one();
+            thread_.join();
+        }
+
+        int64_t push(std::vector<OutputFile> files, std::function<void()> on_done)
+        {
+            int64_t handle;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                handle = next_handle_++;
+                pending_.insert(handle);
+                queue_.push_back(Job{ handle, std::move(files), std::move(on_done) });
+            }
+            work_.notify_one();
+            return handle;
+        }
+
+        int wait(int64_t handle)
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (!pending_.count(handle) && !finished_.count(handle)) {
+                return -1;
+            }
+            // Wait for the job to leave pending_, not to appear in
+            // finished_: another waiter may already have taken its result,
+            // or it may have been trimmed past kMaxFinished.
+            done_.wait(lock, [&] { return pending_.count(handle) == 0; });
+            auto it = finished_.find(handle);
+            if (it == finished_.end()) {
+                return -1;
+            }
+            int ok = it->second ? 1 : 0;
+            finished_.erase(it);
+            return ok;
+        }
+
+    private:
+        void run()
+        {
+            for (;;) {
+                Job job;
+                {
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    work_.wait(lock, [&] { return stop_ || !queue_.empty(); });
+                    // Drain what's queued even when stopping: those files
+                    // were promised to the caller.
+                    if (queue_.empty()) return;
+                    job = std::move(queue_.front());
+                    queue_.pop_front();
+                }
+
+                bool ok = true;
+                for (const auto& f : job.files) {
+                    ok = write_output(f) && ok;
+                }
+                job.files.clear();
+                if (job.on_done) job.on_done();
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    pending_.erase(job.handle);
+                    finished_[job.handle] = ok;
+                    while (finished_.size() > kMaxFinished) {
+                        finished_.erase(finished_.begin());
+                    }
+                }
+                done_.notify_all();
+            }
+        }
+
+        std::mutex mutex_;
+        std::condition_variable work_;
+        std::condition_variable done_;
+        std::deque<Job> queue_;
+        std::set<int64_t> pending_;
+        std::map<int64_t, bool> finished_;
+        int64_t next_handle_ = 1;
+        bool stop_ = false;
+        std::thread thread_;
+    };
+
+    Writer& writer()
+    {
+        static Writer w;
+        return w;
+    }
+
+    std::vector<int> encode_params(const std::string& ext, int quality)
+    {
+        std::vector<int> params;
+        if (quality < 0) return params;
+        if (ext == ".jpg" || ext == ".jpeg") {
+            params = { cv::IMWRITE_JPEG_QUALITY, std::min(quality, 100) };
+        } else if (ext == ".webp") {
+            params = { cv::IMWRITE_WEBP_QUALITY, std::max(1, std::min(quality, 100)) };
+        } else if (ext == ".png") {
+            params = { cv::IMWRITE_PNG_COMPRESSION, std::min(quality, 9) };
+        }
+        return params;
+    }
+}
+
+OutputOptions parse_output_options(const std::string& options)
+{
+    OutputOptions out;
+    std::stringstream ss(options);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        size_t eq = item.find('=');
+        if (eq == std::string::npos) continue;
+        std::string key = item.substr(0, eq);
+        std::string value = item.substr(eq + 1);
+        if (key == "async") {
+            out.async = value == "1" || value == "true";
+        } else if (key == "format") {
+            out.format = value;
+        } else if (key == "quality") {
+            out.quality = std::atoi(value.c_str());
+        }
+    }
+    return out;
+}
+
+bool write_output(const OutputFile& file)
+{
+    std::string ext;
+    if (!file.options.format.empty()) {
+        ext = "." + file.options.format;
+    } else {
+        size_t dot = file.path.find_last_of('.');
+        size_t slash = file.path.find_last_of("/\\");
+        if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+            return false;
+        }
+        ext = file.path.substr(dot);
+    }
+    for (auto& c : ext) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+
+    std::vector<uchar> bytes;
+    try {
+        if (file.image.empty() || !cv::imencode(ext, file.image, bytes, encode_params(ext, file.options.quality))) {
+            return false;
+        }
+    } catch (const cv::Exception&) {
+        return false;
+    }
+
+    std::string tmp = file.path + ".part";
+    FILE* fp = std::fopen(tmp.c_str(), "wb");
+    if (!fp) return false;
+    bool ok = std::fwrite(bytes.data(), 1, bytes.size(), fp) == bytes.size();
+    ok = std::fclose(fp) == 0 && ok;
+    if (!ok || std::rename(tmp.c_str(), file.path.c_str()) != 0) {
+        std::remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+int64_t queue_outputs(std::vector<OutputFile> files, std::function<void()> on_done)
+{
+    return writer().push(std::move(files), std::move(on_done));
+}
+
+extern "C" __attribute__((visibility("default"))) __attribute__((used))
+int tlc_wait_output(int64_t handle)
+{
+    return writer().wait(handle);
+}
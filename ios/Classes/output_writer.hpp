@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stdint.h>
+
+// Encoding and writing of annotated output images, optionally on a
+// background writer thread.
+//
+// Every file-based entry point used to block on cv::imwrite before
+// returning its results, although callers only need the JSON right away;
+// encoding a 12 MP plate is a large share of the call. In async mode the
+// image is handed to a single writer thread instead and the call returns
+// a handle. tlc_wait_output(handle) blocks until that output is on disk —
+// wait before reading the file back (e.g. to display it).
+//
+// Options are the usual comma-separated key=value list:
+//   async=1       write on the writer thread (process_tlc only; the
+//                 *_async entry points always do)
+//   format=jpg    encoder, overriding the output path's extension
+//                 (jpg, png, webp, ...); the path itself is kept as given
+//   quality=N     JPEG/WebP quality 0-100, or PNG compression level 0-9;
+//                 absent keeps the encoder default
+//
+// Files are encoded in memory and renamed into place, so a reader never
+// sees a half-written image.
+
+// Blocks until the output behind `handle` has been written. Returns 1 if
+// every file was written, 0 if any failed, -1 for an unknown handle
+// (never issued, already waited on, or finished so long ago that its
+// result was dropped). Only one waiter gets a handle's result; any other
+// concurrent waiter returns -1 once the output is written.
+#ifdef __cplusplus
+extern "C"
+#endif
+int tlc_wait_output(int64_t handle);
+
+#ifdef __cplusplus
+#include <functional>
+#include <string>
+#include <vector>
+#include <opencv2/core.hpp>
+
+struct OutputOptions
+{
+    bool async = false;
+    std::string format;  // empty = from the path's extension
+    int quality = -1;    // -1 = encoder default
+};
+
+struct OutputFile
+{
+    cv::Mat image;       // not modified by the writer; don't draw on it after queueing
+    std::string path;
+    OutputOptions options;
+};
+
+OutputOptions parse_output_options(const std::string& options);
+
+// Encodes and writes one file on the calling thread.
+bool write_output(const OutputFile& file);
+
+// Queues files for the writer thread and returns their handle (> 0).
+// on_done, if set, runs on the writer thread once they are all written.
+int64_t queue_outputs(std::vector<OutputFile> files, std::function<void()> on_done = nullptr);
+#endif